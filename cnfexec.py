@@ -238,6 +238,17 @@ class UksatNowatchRunner(UksatRunner):
 	CmdFormat = ['%(cmdname)s', '-W', '-t', '%(timelimit)d', '%(inputpath)s']
 
 
+class UksatProofRunner(UksatRunner):
+	Type = "proof"
+	CmdName = UksatRunner.CmdName
+	CmdFormat = ['%(cmdname)s', '-t', '%(timelimit)d', '--proof', '%(proofpath)s', '%(inputpath)s']
+
+	def __init__(self, *args, **kargs):
+		# The proof is discarded by default, so that only the logging itself is measured
+		self.proofpath = kargs.get('proofpath', '/dev/null')
+		UksatRunner.__init__(self, *args, **kargs)
+
+
 class MinisatRunner(Runner):
 	SatCode = 10
 	UnsatCode = 20
@@ -3,12 +3,16 @@
 
 
 #include <cstddef>
+#include <cstdio>
 #include <ctime>
+#include <stdint.h>
 #include <vector>
 #include <map>
+#include <new>
 #include <set>
 #include <iosfwd>
 #include <sstream>
+#include <string>
 
 #define uksat_STRQT(s) #s
 #define uksat_STRFY(s) uksat_STRQT(s)
@@ -26,8 +30,14 @@
     "-" uksat_RELEASETYPE
 #define uksat_RELEASENAME uksat_NAME " " uksat_VERSIONNAME
 
+// Formulas saved by CnfFormula::savebinary start with the magic, and are
+// saved this way by CnfFormula::savefile when the name has this extension
+#define uksat_BINARYMAGIC "\177UKB"
+#define uksat_BINARYEXT   ".ukb"
+
 #define uksat_NORMALLIT(l)    (((l) < 0) ?   -(l) :   (l))
 #define uksat_INVERTLIT(l)    (-(l))
+#define uksat_LITIDX(l)       (((l) < 0) ? (2 * -(l) + 1) : (2 * (l)))
 #define uksat_NORMALVAL(l, v) (((l) >= 0) ? (v) : ((v < 0) ? 1 : -1))
 #define uksat_BOOLVAL(l, v)   ( uksat_NORMALVAL(l, v) > 0 ? true : false )
 
@@ -187,48 +197,233 @@ struct NullStream : public std::stringstream {
 };
 static NullStream nullstream;
 
+
+// Bytes held by a vector (or by a vector of vectors), for the memory tracked
+// by the solvers
+template <typename T>
+inline std::size_t memoryof(const std::vector<T>& vec) {
+    return vec.capacity() * sizeof(T);
+}
+
+template <typename T>
+inline std::size_t memoryof(const std::vector<std::vector<T> >& vecs) {
+    std::size_t bytes = vecs.capacity() * sizeof(std::vector<T>);
+    for (typename std::vector<std::vector<T> >::const_iterator it = vecs.begin(); it != vecs.end(); ++it) {
+        bytes += it->capacity() * sizeof(T);
+    }
+    return bytes;
+}
+
+
+// Size classes of the arena: chunks of 16 to 256 bytes, by steps of 16 (the
+// nodes of the watch lists, short lists), then of 512 to 4096 bytes, by
+// powers of two. Larger chunks are taken from the heap.
+#define uksat_ARENA_STEPBYTES  16
+#define uksat_ARENA_NSTEPS     16
+#define uksat_ARENA_NCLASSES   20
+#define uksat_ARENA_MAXBYTES   4096
+
+
+// Monotonic arena of the solver structures: chunks are carved out of large
+// blocks, and the chunks given back are kept by size class for the next
+// allocations of their class. `reset()` takes every chunk back at once, and
+// keeps the blocks, so that a reused solver allocates nothing new
+class Arena {
+public:
+    Arena();
+    ~Arena();
+
+    // A free chunk of the class, if there is one (inline, as the watch
+    // lists take and give back nodes all the time)
+    void* allocate(std::size_t bytes) {
+        if (bytes > uksat_ARENA_MAXBYTES) return allocatelarge(bytes);
+        std::size_t cls = sizeclass(bytes);
+        void* chunk = freechunks[cls];
+        if (!chunk) return carve(cls);
+        freechunks[cls] = *static_cast<void**>(chunk);
+        return chunk;
+    }
+
+    // The chunk is linked in front of the free chunks of its class
+    void release(void* chunk, std::size_t bytes) {
+        if (bytes > uksat_ARENA_MAXBYTES) return releaselarge(chunk, bytes);
+        std::size_t cls = sizeclass(bytes);
+        *static_cast<void**>(chunk) = freechunks[cls];
+        freechunks[cls] = chunk;
+    }
+
+    void reset();
+    std::size_t getmemory() const;
+
+private:
+    Arena(const Arena& other);
+    Arena& operator=(const Arena& other);
+    void* carve(std::size_t cls);
+    void* allocatelarge(std::size_t bytes);
+    void releaselarge(void* chunk, std::size_t bytes);
+
+    static std::size_t sizeclass(std::size_t bytes) {
+        if (bytes <= uksat_ARENA_STEPBYTES * uksat_ARENA_NSTEPS) {
+            return bytes ? (bytes - 1) / uksat_ARENA_STEPBYTES : 0;
+        }
+        std::size_t cls = uksat_ARENA_NSTEPS;
+        std::size_t classbytes = 2 * uksat_ARENA_STEPBYTES * uksat_ARENA_NSTEPS;
+        while (classbytes < bytes) {
+            classbytes <<= 1;
+            cls++;
+        }
+        return cls;
+    }
+
+private:
+    std::vector<char*> blocks;
+    std::size_t blockidx;                       // Block being carved
+    std::size_t blockpos;                       // Bytes carved out of it
+    void* freechunks[uksat_ARENA_NCLASSES];     // First free chunk of each class
+    std::size_t nlarge;                         // Bytes of the chunks too large for a class
+};
+
+
+// Allocator of the standard containers in an arena (or on the heap, without
+// an arena)
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    template <typename U> struct rebind { typedef ArenaAllocator<U> other; };
+
+    ArenaAllocator() : arena(NULL) {}
+    explicit ArenaAllocator(Arena* _arena) : arena(_arena) {}
+    template <typename U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    pointer address(reference value) const { return &value; }
+    const_pointer address(const_reference value) const { return &value; }
+    size_type max_size() const { return static_cast<size_type>(-1) / sizeof(T); }
+    void construct(pointer ptr, const T& value) { new (static_cast<void*>(ptr)) T(value); }
+    void destroy(pointer ptr) { ptr->~T(); }
+
+    pointer allocate(size_type n, const void* = NULL) {
+        return static_cast<pointer>(arena ? arena->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(pointer ptr, size_type n) {
+        if (arena) arena->release(ptr, n * sizeof(T));
+        else ::operator delete(ptr);
+    }
+
+    Arena* arena;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena == rhs.arena;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena != rhs.arena;
+}
+
+// Literal and index lists of the solvers, by literal, in their arena
+typedef std::vector<int, ArenaAllocator<int> > LitList;
+typedef std::vector<std::size_t, ArenaAllocator<std::size_t> > IndexList;
+
+
 struct PartialMap;
 class CnfFormula;
+class ProofWriter;
 
 class Solver;
 
 class CnfFormula {
 public:
+    // Read-only view of a clause, stored in the formula's literal arena
+    class Clause {
+    public:
+        typedef const int* const_iterator;
+        Clause(const int* _first, const int* _last) : first(_first), last(_last) {}
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+        std::size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+        int operator[](std::size_t idx) const { return first[idx]; }
+    private:
+        const int* first;
+        const int* last;
+    };
+    
 	CnfFormula();
 	CnfFormula(unsigned int numvars, std::vector<std::vector<int> >& clist);
 
 	int getnvars() const;
 	int getnclauses() const;
+    int getncardinalities() const;
     int totalfrequency(int normvar) const;
     int frequency(int var) const;
     const std::vector<int>& getvarorder() const;
-	const std::vector<int>& operator[](int clauseidx) const;
+	Clause operator[](int clauseidx) const;
+    Clause getcardinality(int cardidx) const;
+    int getbound(int cardidx) const;
+    const std::vector<int>& getliterals() const;
+    const std::vector<std::size_t>& getoffsets() const;
+    int getnthreads() const;
+    void setnthreads(int nthreads);
+    std::size_t getmemory() const;
 
 	bool isvalid() const;
+	void setclauses(int numvars, const std::vector<std::vector<int> >& clist);
+    bool addcardinality(const std::vector<int>& lits, int bound);
+    int check(const std::vector<signed char>& values) const;
+    uint64_t check(const std::vector<uint64_t>& models) const;
+    void findxors(std::vector<std::vector<int> >& xors, std::vector<bool>& parities) const;
 	bool openfile(const char* filename);
 	bool openfile(std::istream& is);
+    bool openfd(int fd);
+    bool openbuffer(const char* data, std::size_t size);
 	bool savefile(const char* filename);
 	bool savefile(std::ostream& os);
+    bool savebinary(std::ostream& os);
     bool savesolution(const char* filename, Solver& solver);
     bool savesolution(std::ostream& os, Solver& solver);
 private:
+    void clearcardinalities();
+    void buildvarorder();
+    int mapbinary(const char* filename);
+    int opencompressed(const char* filename);
+    int mapdimacs(const char* filename);
+    bool parsedimacs(const char* data, std::size_t size);
+    bool readdimacs(int fd);
+    void countfrequencies(std::size_t nchunks);
+    bool readbinary(std::istream& is);
+    bool openbinary(const char* data, std::size_t size);
+
 	int nvars;
 	int nclauses;
-	std::vector<std::vector<int> > clauses;
-    std::map<int, int> varfrequencies;
+    std::vector<int> literals;          // All clauses, back to back
+    std::vector<std::size_t> offsets;   // Start of each clause in `literals`, and the end of the last one
+    std::vector<int> frequencies;       // Occurrences of each literal, by uksat_LITIDX
     std::vector<int> varorder;
+    int nthreads;                       // Used to parse files, 0 for one per core
+
+    // Cardinality constraints (at most `bound` of the literals true), back to
+    // back as the clauses, given by "<lits> <= <bound>" lines in "p cnf+" files
+    std::vector<int> cardliterals;
+    std::vector<std::size_t> cardoffsets;
+    std::vector<int> cardbounds;
 };
 
 
 struct PartialMap {
-    struct Entry {
-        int truth;
-        int truthtime;
-        std::set<std::size_t> tclauses;
-        std::set<std::size_t> fclauses;
-        Entry() : truth(0), truthtime(0) {}
-        Entry(const Entry& other) : truth(other.truth), truthtime(other.truthtime), tclauses(other.tclauses), fclauses(other.fclauses) { }
-    };
+    // Watched clause indexes, each mapped to a blocker literal of the clause,
+    // with their nodes in the arena of the map
+    typedef std::map<std::size_t, int, std::less<std::size_t>,
+        ArenaAllocator<std::pair<const std::size_t, int> > > WatchList;
     
     // Constructors
     PartialMap();
@@ -238,7 +433,9 @@ struct PartialMap {
     // Getters / Setters
     int getnvars() const;
     void setnvars(int nvars);
-    std::set<std::size_t>& getwatches(int var);
+    WatchList& getwatches(int var);
+    int getreason(int var) const;
+    void setreason(int var, int reason);
     int size() const;
 
     // Operations
@@ -255,13 +452,59 @@ struct PartialMap {
     bool get(int var) const;
     int  sat(int var) const;
     void copy(std::map<int, bool>& other) const;
+    std::size_t getmemory() const;
 
-    // Fields
-    std::vector<Entry> map;
+    // Fields, one entry per var (index = var - 1), kept apart so that
+    // value lookups during propagation only touch the `values` array
+    std::vector<signed char> values;  // -1, 0 (unassigned) or 1
+    std::vector<int> levels;          // Assignment time (negative if inverted)
+    std::vector<int> reasons;         // Index of the implying clause, or -1
+    Arena arena;                      // Nodes of the watch lists
+    std::vector<WatchList> watches;   // Watch lists, by LITIDX
     std::size_t mapsize;
 };
 
 
+class ProofWriter {
+public:
+    ProofWriter();
+    virtual ~ProofWriter();
+    
+    // Getters / Setters
+    bool isopen() const;
+    bool isbinary() const;
+    void setbinary(bool binary);
+    std::size_t getnadded() const;
+    std::size_t getndeleted() const;
+    uint64_t getnbytes() const;
+    
+    // Opens the proof output: "-" is STDOUT, and "|cmd" pipes the proof
+    // into the shell command `cmd`. Anything else is a file path.
+    bool open(const char* path);
+    bool close();
+    void flush();
+    
+    // Clause additions and deletions, in DRAT
+    void add(const int* begin, const int* end);
+    void add(const std::vector<int>& clause);
+    void erase(const int* begin, const int* end);
+    void erase(const std::vector<int>& clause);
+    
+protected:
+    virtual void write(char type, const int* begin, const int* end);
+    
+protected:
+    FILE* file;
+    bool piped;
+    bool binary;
+    std::vector<char> buffer;
+    std::size_t bufferpos;
+    std::size_t nadded;
+    std::size_t ndeleted;
+    uint64_t nbytes;
+};
+
+
 class Solver {
 public:
 	Solver(CnfFormula& _formula);
@@ -285,11 +528,20 @@ public:
     virtual double getmaxtime() const;
     virtual void setmaxtime(double secs);
     virtual bool intime();
+    virtual std::size_t getmaxmemory() const;
+    virtual void setmaxmemory(std::size_t bytes);
+    virtual bool hasmemout() const;
+    virtual bool inbudget();
+    virtual std::size_t getmemory() const;
+    virtual std::size_t getpeakmemory() const;
+    virtual ProofWriter* getproof() const;
+    virtual void setproof(ProofWriter* writer);
 	
 	// Actions
     virtual void clear();
 	virtual int  apply();
 	virtual int  checkclause(std::size_t clauseidx);
+    virtual void printstats(std::ostream& os);
 
 	// The query function
 	virtual bool query() = 0;
@@ -300,6 +552,7 @@ protected:
     virtual void finish(int truth = 0);
     virtual int choosefreevar();
     virtual std::ostream& log(LogTypeId type = LOG_TEXT);
+    bool isstopped() const;
 
 protected:
 	// Input and Options
@@ -308,6 +561,7 @@ protected:
     std::ostream* logstream;
     bool logall;
     std::set<LogTypeId> logtypes;
+    ProofWriter* proof;
 
 	// Results
 	int result;
@@ -318,6 +572,14 @@ protected:
 	std::clock_t clockbegin;
 	std::clock_t clockend;
 	bool timeout;
+
+    // Memory budget (0 for none), with the memory last measured and the
+    // most measured, and the calls to `inbudget()` since the solver started
+    std::size_t maxmemory;
+    std::size_t memory;
+    std::size_t peakmemory;
+    std::size_t nmemchecks;
+    bool memout;
 };
 
 
@@ -325,10 +587,27 @@ class SimpleDpllSolver : public Solver {
 public:
     SimpleDpllSolver(CnfFormula& _formula);
 	virtual bool query();
+    virtual void printstats(std::ostream& os);
+    virtual std::size_t getmemory() const;
+    
+    // Model enumeration (AllSAT): every model found is counted and written
+    // as a clause of its literals, over the projected vars (every var if
+    // none)
+    uint64_t getnmodels() const;
+    uint64_t getninvalidmodels() const;
+    const std::vector<int>& getprojection() const;
+    void setprojection(const std::vector<int>& vars);
+    ProofWriter* getmodelwriter() const;
+    void setmodelwriter(ProofWriter* writer);
+    virtual uint64_t enumerate(uint64_t maxmodels = 0);
     
 protected:
     virtual int currtime();
     virtual int currvar();
+    virtual int choosefreevar();
+    virtual bool addmodel(uint64_t maxmodels);
+    virtual void checkmodels();
+    bool isprojected(int var) const;
     
     virtual void clear();
 	virtual bool querystep();
@@ -340,27 +619,104 @@ protected:
     virtual std::pair<int, bool> pop();
 	virtual std::pair<int, bool> pop(std::vector<int>& poppedvars);
     virtual int propagateclause(std::size_t clauseidx);
+    virtual int propagatecardinality(std::size_t cardidx);
+    virtual void prove(int flippedvar);
     virtual void printdecisions();
 
 protected:
     std::size_t ncalls;
+    std::size_t ndecisions;
+    std::size_t npropagations;
+    std::size_t nclausereads;
     
     // Stack
 	std::vector<std::pair<int, bool> > decisions;
 	std::vector<std::pair<int, int> > propagations;
+    
+    // Clauses written to the proof and still needed, back to back, with
+    // the decision level each one flipped
+    std::vector<int> proofclause;
+    std::vector<int> prooflits;
+    std::vector<std::size_t> proofoffsets;
+    std::vector<std::size_t> prooflevels;
+    
+    // Enumeration, with the projected vars (by var) and the literals of the
+    // last model, where the free vars are at `freelits`
+    std::vector<int> projection;
+    std::vector<bool> projected;
+    ProofWriter* modelwriter;
+    uint64_t nmodels;
+    std::vector<int> modellits;
+    std::vector<std::size_t> freelits;
+    
+    // Models waiting to be checked together, one bit per model in the word of
+    // each var, and the models found not to satisfy the formula
+    std::vector<uint64_t> modelbits;
+    std::size_t nbatched;
+    uint64_t ninvalidmodels;
+};
+
+
+// XOR constraints as the rows of a bit-packed matrix (one column per var, and
+// the parity last), kept in reduced row echelon form by Gauss-Jordan
+// elimination. Each row has a basic var, found in no other row, which is
+// moved to another unassigned var of the row when it gets assigned.
+class XorMatrix {
+public:
+    XorMatrix();
+
+    // Getters
+    std::size_t getnrows() const;
+    std::size_t getncols() const;
+    std::size_t getnpivots() const;
+    bool isconsistent() const;
+    std::size_t getmemory() const;
+
+    // Actions
+    void clear();
+    bool load(int nvars, const std::vector<std::vector<int> >& xors, const std::vector<bool>& parities);
+    bool assign(int lit, std::vector<int>& implied);
+    bool propagate(std::vector<int>& implied);
+    void unassign(int var);
+
+protected:
+    // Helpers
+    uint64_t* getrow(std::size_t rowidx);
+    bool hasbit(std::size_t rowidx, int col);
+    void addrow(std::size_t dstidx, std::size_t srcidx);
+    void pivot(std::size_t rowidx, int col);
+    int findunassigned(std::size_t rowidx);
+    int checkrow(std::size_t rowidx, std::vector<int>& implied);
+    void touch(std::size_t rowidx);
+
+protected:
+    std::size_t nrows;
+    std::size_t nwords;                 // Per row, the parity included
+    std::vector<uint64_t> rows;
+    std::vector<int> basics;            // Column of the basic var of each row
+    std::vector<int> columns;           // Column of each var, -1 if in no XOR
+    std::vector<int> colvars;           // Var of each column
+    std::vector<uint64_t> assigned;     // Parity column always set
+    std::vector<uint64_t> values;       // Parity column always true
+    bool consistent;
+    std::size_t npivots;
+    
+    // Rows to check after an assignment
+    std::vector<std::size_t> touched;
+    std::vector<char> istouched;
 };
 
 
 class WatchedDpllSolver: public SimpleDpllSolver {
 public:
 	struct ClauseState {
-        bool satisfied;
-        int sattime;
         std::pair<int, int> watches;
-        ClauseState() : satisfied(false), sattime(0) {}
-        ClauseState(const ClauseState& other) : satisfied(other.satisfied), sattime(other.sattime), watches(other.watches) {}
+        ClauseState() {}
+        ClauseState(const ClauseState& other) : watches(other.watches) {}
     };
     WatchedDpllSolver(CnfFormula& _formula);
+    virtual void printstats(std::ostream& os);
+    virtual std::size_t getmemory() const;
     
 protected:
     virtual void clear();
@@ -370,6 +726,9 @@ protected:
 	virtual void push(int var, bool decision = false);
 	virtual void push(const std::pair<int, bool>& decision);
 	virtual std::pair<int, bool> pop(std::vector<int>& poppedvars);
+    virtual void imply(int var, std::size_t clauseidx);
+    virtual bool triggercardinalities(int var);
+    virtual bool triggerxors(int var);
     
     virtual int registerwatches();
     virtual int findwatchvar(std::size_t clauseidx, int knownvar = 0);
@@ -377,20 +736,678 @@ protected:
     
     virtual void watch(std::size_t clauseidx, int var, int substvar = 0);
     virtual void trigger(int var);
-    virtual void undotrigger(int var);
     
-    virtual bool isvalidtime(int assigntime);
-    virtual bool isvalidclausesat(std::size_t clauseidx);
-    virtual void setclausesat(std::size_t clauseidx, int time = 0);
-    virtual void eraseclausesat(std::size_t clauseidx);
     virtual std::pair<int, int>& getclausewatches(std::size_t clauseidx);
-    virtual std::set<std::size_t>& getwatchset(int var);
-    virtual std::set<std::size_t>& getinvwatchset(int var);
+    virtual PartialMap::WatchList& getwatchset(int var);
+    virtual PartialMap::WatchList& getinvwatchset(int var);
+    virtual LitList& getimplications(int var);
+    virtual IndexList& getcardinalities(int var);
     
 protected:
     // Watches
     std::vector<ClauseState> cstates;
-    std::size_t nsatclauses;
+    
+    // Lists of the binary clauses and of the cardinality constraints
+    Arena arena;
+    
+    // Binary clauses, as the literals implied by each literal (by LITIDX)
+    std::vector<LitList> implications;
+    std::size_t nbinclauses;
+    
+    // Watches skipped because of a true blocker literal
+    std::size_t nblocked;
+    
+    // Cardinality constraints of each literal (by LITIDX), and the true
+    // literals counted in each constraint
+    std::vector<IndexList> cardinalities;
+    std::vector<int> cardcounts;
+    std::size_t ncardprops;
+    
+    // XORs recovered from the clauses, propagated by Gauss-Jordan elimination
+    XorMatrix xormatrix;
+    std::size_t nxorprops;
+};
+
+
+class BruteForceSolver : public Solver {
+public:
+    BruteForceSolver(CnfFormula& _formula);
+    
+    // Getters / Setters
+    int getmaxvars() const;
+    void setmaxvars(int maxvars);
+    bool isfeasible() const;
+    
+    virtual bool query();
+    virtual void printstats(std::ostream& os);
+    virtual std::size_t getmemory() const;
+    
+protected:
+    virtual void clear();
+    virtual void load();
+    virtual uint64_t evaluate(uint64_t word);
+    virtual void assign(uint64_t word, uint64_t models);
+    
+protected:
+    int maxvars;
+    
+    // Occurring vars (bit position -> var) and the clauses, as literals
+    // (bit position * 2 + 1 when negated) over those positions
+    std::vector<int> vars;
+    std::vector<std::vector<int> > clauses;
+    
+    std::size_t nwords;
+    std::size_t nclausereads;
+};
+
+
+// Exact non-negative integer, as 32-bit limbs (lowest first, without
+// trailing zero limbs), for model counts past 2^64
+class ModelCount {
+public:
+    ModelCount(uint64_t value = 0);
+
+    bool iszero() const;
+    void add(const ModelCount& other);
+    void multiply(const ModelCount& other);
+    void shift(std::size_t bits);
+    std::string str() const;
+
+protected:
+    std::vector<uint32_t> limbs;
+};
+
+
+// Base of the solvers working on an assignment of their own: unit
+// propagation through two watched literals per clause, on a trail that can be
+// undone down to any earlier size
+class PropagatingSolver : public Solver {
+public:
+    PropagatingSolver(CnfFormula& _formula);
+
+    virtual std::size_t getmemory() const;
+
+protected:
+    virtual void clear();
+    virtual void loadwatches();
+    virtual bool assign(int lit);
+    virtual bool propagate();
+    virtual void undo(std::size_t trailsize);
+    int value(int lit) const;
+
+protected:
+    // Assignment, with the clauses watching each literal (by uksat_LITIDX,
+    // in the arena) and the positions of the two watched literals of each
+    // clause
+    Arena arena;
+    std::vector<IndexList> watches;
+    std::vector<std::pair<std::size_t, std::size_t> > clausewatches;
+    std::vector<int> values;
+    std::vector<int> trail;
+    std::size_t qhead;
+};
+
+
+// Exact model counting (#SAT): DPLL over the independent components of the
+// residual formula, with the count of each component cached by its vars and
+// clauses
+class CountingSolver : public PropagatingSolver {
+public:
+    CountingSolver(CnfFormula& _formula);
+
+    // Getters / Setters
+    const ModelCount& getcount() const;
+    std::size_t getmaxcache() const;
+    void setmaxcache(std::size_t nlits);
+
+    virtual bool query();
+    virtual void printstats(std::ostream& os);
+    virtual std::size_t getmemory() const;
+
+protected:
+    virtual void clear();
+    virtual void load();
+    virtual void countresidual(const std::vector<int>& vars, const std::vector<std::size_t>& clauseidxs, ModelCount& count);
+    virtual void countcomponent(const std::vector<int>& vars, const std::vector<std::size_t>& clauseidxs, ModelCount& count);
+    virtual int choosebranchvar(const std::vector<int>& vars, const std::vector<std::size_t>& clauseidxs);
+    virtual bool lookup(const std::vector<int>& key, ModelCount& count);
+    virtual void store(const std::vector<int>& key, const ModelCount& count);
+    bool issatclause(std::size_t clauseidx) const;
+    int findroot(int var);
+
+protected:
+    ModelCount count;
+    std::size_t maxcache;
+
+    // Union-find of the vars of a residual formula, and scores by var
+    std::vector<int> roots;
+    std::vector<int> scores;
+
+    // Component cache: the keys (component vars, 0, clause indices) back to
+    // back, found by hash, and their counts
+    std::multimap<uint64_t, std::size_t> cachedhashes;
+    std::vector<int> cachedkeys;
+    std::vector<std::size_t> cachedoffsets;
+    std::vector<ModelCount> cachedcounts;
+
+    // Statistics
+    std::size_t ndecisions;
+    std::size_t ncomponents;
+    std::size_t ncachehits;
+    std::size_t ncacheflushes;
+};
+
+
+// DPLL with lookahead: at each node, both literals of the candidate vars
+// (the first free ones in the frequency order) are propagated on the trail
+// and undone. A literal that conflicts is failed, and its negation is
+// assigned; otherwise the var with the best reduction (new binary clauses on
+// both sides) is branched on. Literals reducing a lot get a double
+// lookahead, not repeated below the node where it found nothing.
+class LookaheadSolver : public PropagatingSolver {
+public:
+    LookaheadSolver(CnfFormula& _formula);
+
+    // Getters / Setters
+    std::size_t getmaxcandidates() const;
+    void setmaxcandidates(std::size_t ncandidates);
+
+    virtual bool query();
+    virtual void printstats(std::ostream& os);
+    virtual std::size_t getmemory() const;
+
+protected:
+    virtual void clear();
+    virtual void load();
+    virtual bool lookahead(int& branchlit);
+    virtual int  probe(int lit);
+    virtual bool doublelookahead();
+    virtual int  reduction(std::size_t trailsize);
+    virtual void selectcandidates(std::vector<int>& cands, std::size_t maxcands);
+    bool iscached(int lit) const;
+
+protected:
+    std::size_t maxcandidates;
+
+    // Clauses of three literals or more containing each literal (by
+    // uksat_LITIDX, in their arena), and the probe that last scored each
+    // clause
+    Arena occurrencearena;
+    std::vector<IndexList> occurrences;
+    std::vector<unsigned int> clausestamps;
+    unsigned int stamp;
+
+    // Search stack: the trail size before each decision, the literal
+    // decided, whether it's flipped already, and the node it opened
+    std::vector<std::size_t> leveltrails;
+    std::vector<int> levellits;
+    std::vector<bool> levelflips;
+    std::vector<std::size_t> levelnodes;
+
+    // Candidates of the current node and of the double lookahead, and the
+    // double lookahead cache: the level and node (by uksat_LITIDX) where a
+    // literal's last one found nothing. The trigger decays at every node, and
+    // is raised to the reduction of the literals that found nothing.
+    std::vector<int> candidates;
+    std::vector<int> dlcandidates;
+    std::vector<int> dllevels;
+    std::vector<std::size_t> dlnodes;
+    double dltrigger;
+
+    // Statistics
+    std::size_t nnodes;
+    std::size_t nprobes;
+    std::size_t nfailed;
+    std::size_t ndoublelookaheads;
+    std::size_t ndlfailed;
+    std::size_t ndlcachehits;
+};
+
+
+// Exit codes of uksat for the results of the solvers, as cnfexec.py reads them
+#define uksat_SATCODE     10
+#define uksat_UNSATCODE   20
+#define uksat_UNDEFCODE   30
+#define uksat_TIMEOUTCODE 40
+
+
+enum SolverTypeId {
+    SOLVER_SIMPLE = 0,
+    SOLVER_WATCHED,
+    SOLVER_BRUTEFORCE,
+    SOLVER_COUNTING,
+    SOLVER_LOOKAHEAD,
+
+    SOLVER__MAX = SOLVER_LOOKAHEAD
+};
+
+
+// The solver for a formula: the brute force one for small formulas when
+// `choosing`, else the DPLL one (with watched literals if `watching`)
+SolverTypeId choosesolver(CnfFormula& formula, bool choosing, bool watching);
+Solver* newsolver(CnfFormula& formula, SolverTypeId type);
+
+// The result of a solver, as uksat reports it ("SATISFIABLE",
+// "UNSATISFIABLE", "TIMEOUT", "MEMOUT" or "UNDEFINED"), and its exit code
+const char* resultname(const Solver& solver);
+int resultcode(const Solver& solver);
+
+
+// Solvers of a formula built on first use and reused from formula to formula
+// (as the server and batch workers do), one of each type
+class SolverCache {
+public:
+    explicit SolverCache(CnfFormula& _formula);
+    ~SolverCache();
+
+    void setmaxtime(double secs);
+    Solver& get(SolverTypeId type);
+
+private:
+    SolverCache(const SolverCache& other);
+    SolverCache& operator=(const SolverCache& other);
+
+private:
+    CnfFormula& formula;
+    double maxtime;
+    std::vector<Solver*> solvers;   // By type, NULL until used
+};
+
+
+class Simplifier {
+public:
+    Simplifier(CnfFormula& _formula);
+
+    // Getters and Setters
+    std::size_t getmaxprobes() const;
+    void setmaxprobes(std::size_t nprobes);
+    std::size_t getmaxprobesteps() const;
+    void setmaxprobesteps(std::size_t nsteps);
+    std::size_t getnprobes() const;
+    std::size_t getnfailed() const;
+    std::size_t getnequivalences() const;
+    std::size_t getnremoved() const;
+    ProofWriter* getproof() const;
+    void setproof(ProofWriter* writer);
+
+    // Actions
+    int  simplify();
+    void extend(PartialMap& partial) const;
+
+protected:
+    // Helpers
+    virtual int  reduce();
+    virtual void load();
+    virtual void store(int sat);
+    virtual bool assign(int lit);
+    virtual bool propagate();
+    virtual void undo(std::size_t trailsize);
+    virtual int  probe(int lit);
+    virtual int  probevars();
+    virtual int  substitute();
+    virtual int  rewrite();
+    virtual void prove();
+    virtual void refute();
+    int value(int lit) const;
+
+protected:
+    CnfFormula& formula;
+    std::size_t maxprobes;
+    std::size_t maxprobesteps;
+    ProofWriter* proof;
+    std::size_t nproved;     // Trail literals already written as units
+
+    // Working copy of the formula
+    std::vector<std::vector<int> > clauses;
+    std::vector<std::vector<std::size_t> > occurs;
+    std::vector<int> values;
+    std::vector<int> trail;
+    std::size_t qhead;
+
+    // Substituted literals, by literal index, and their reconstruction order
+    std::vector<int> reprs;
+    std::vector<std::pair<int, int> > substitutions;
+
+    // Statistics
+    std::size_t nprobes;
+    std::size_t nprobesteps;
+    std::size_t nfailed;
+    std::size_t nequivalences;
+    std::size_t nremoved;
+};
+
+
+// Static symmetry breaking. The symmetries of the formula (permutations of
+// its literals that map the clauses onto themselves) are found as the
+// automorphisms of a graph of its literals and clauses. For each generator
+// found, lex-leader clauses are added, so that the smallest assignment of
+// each orbit (by var index) stays a model.
+class SymmetryBreaker {
+public:
+    SymmetryBreaker(CnfFormula& _formula);
+
+    // Getters and Setters
+    std::size_t getmaxsteps() const;
+    void setmaxsteps(std::size_t nsteps);
+    std::size_t getngenerators() const;
+    std::size_t getnadded() const;
+    std::size_t getnsteps() const;
+
+    // Actions
+    std::size_t breaksymmetries();
+
+protected:
+    // Helpers
+    virtual void load();
+    virtual bool refine(std::vector<int>& colors, uint64_t& trace);
+    virtual void individualize(std::vector<int>& colors, int node);
+    virtual int  findcell(const std::vector<int>& colors);
+    virtual void findgenerators();
+    virtual bool match(std::vector<int>& colors, std::size_t level);
+    virtual bool isautomorphism(const std::vector<int>& images);
+    virtual void addgenerator(const std::vector<int>& images);
+    virtual void store();
+    int findorbit(int node);
+
+protected:
+    CnfFormula& formula;
+    std::size_t maxsteps;
+    std::size_t nsteps;     // Adjacencies read by the refinements
+
+    // Graph: a node for each literal (by LITIDX - 2, so that a var's literals
+    // are next to each other) and for each distinct clause
+    std::vector<std::vector<int> > clauses;
+    std::vector<std::size_t> adjoffsets;
+    std::vector<int> adjnodes;
+    int nlitnodes;
+    int nnodes;
+
+    // First path of the search: the colors at each level, the cell split
+    // there and the node individualized in it, and the refinement traces
+    std::vector<std::vector<int> > levelcolors;
+    std::vector<int> levelcells;
+    std::vector<int> levelnodes;
+    std::vector<uint64_t> leveltraces;
+
+    // Union-find of the literal nodes in the orbits of the generators found
+    std::vector<int> orbits;
+
+    // Generators, as the image of each literal node, and the clauses added
+    std::vector<std::vector<int> > generators;
+    std::vector<std::vector<int> > added;
+};
+
+
+class Verifier {
+public:
+    Verifier();
+    
+    // Getters / Setters
+    int getclaim() const;
+    int getresult() const;
+    int getnvars() const;
+    int getnclauses() const;
+    std::size_t getnchecked() const;
+    long getfailedclause() const;
+    const std::vector<int>& getfailedlits() const;
+    double getelapsedtime() const;
+    bool isvalid() const;
+    bool ismalformed() const;
+    
+    // Checks the solution against the formula, both streamed. Returns 1 if
+    // every clause is satisfied, -1 if some clause is falsified and 0 if
+    // some clause is left unsatisfied by unassigned vars.
+    int verify(std::istream& fml, std::istream& sol);
+    
+protected:
+    virtual void clear();
+    virtual void opensolution(std::istream& sol);
+    virtual void loadsolution();
+    virtual bool checklines(const char* begin, const char* end);
+    virtual void checkclause();
+    virtual void checkcardinality(long bound);
+    
+protected:
+    // Solution: the literals read, then their values once the vars of the
+    // formula are known. Malformed without "s" or "v" lines, or with a
+    // literal out of the vars of the formula.
+    int claim;
+    std::vector<int> model;
+    std::vector<signed char> values;
+    bool malformed;
+    
+    // Formula
+    int nvars;
+    int nclauses;
+    bool gotheader;
+    bool extended;      // "cnf+", with cardinality constraints
+    std::vector<int> clause;
+    
+    // Results
+    int result;
+    std::size_t nchecked;
+    long failedclause;
+    std::vector<int> failedlits;
+    std::clock_t clockbegin;
+    std::clock_t clockend;
+};
+
+
+
+class ProofChecker {
+public:
+    ProofChecker(CnfFormula& _formula);
+    
+    // Getters / Setters
+    int getresult() const;
+    std::size_t getnlemmas() const;
+    std::size_t getndeleted() const;
+    std::size_t getnignored() const;
+    std::size_t getnchecked() const;  // RUP checks, RAT resolvents included
+    std::size_t getncore() const;     // Lemmas checked
+    std::size_t getnrat() const;
+    long getfailedlemma() const;
+    const std::vector<int>& getfailedlits() const;
+    double getelapsedtime() const;
+    
+    // Reads a DRAT proof, in the binary or the text format (detected)
+    bool openproof(const char* filename);
+    bool openproof(std::istream& is);
+    
+    // Checks the proof backwards from its first empty clause (or from its
+    // end). Returns 1 if it refutes the formula, -1 otherwise.
+    int check();
+    
+    // Writes the checked proof in LRAT, with the core lemmas only
+    bool savelrat(const char* filename);
+    bool savelrat(std::ostream& os);
+    
+protected:
+    virtual void clear();
+    virtual std::size_t addclause(const int* begin, const int* end, int pivot);
+    virtual void addstep(bool deletion, const std::vector<int>& clause);
+    virtual long findclause(const std::vector<int>& clause);
+    virtual void activate(std::size_t clauseidx);
+    virtual void deactivate(std::size_t clauseidx);
+    virtual bool rup(const int* begin, const int* end, std::vector<long>& hints);
+    virtual bool rat(std::size_t clauseidx, std::vector<long>& hints);
+    virtual bool assign(int lit, long reason);
+    virtual long propagate();
+    virtual void analyze(long conflict, std::vector<long>& hints);
+    virtual void undo();
+    int value(int lit) const;
+    
+protected:
+    CnfFormula& formula;
+    
+    // Formula clauses followed by the lemmas, deduplicated, in an arena
+    std::vector<int> literals;
+    std::vector<std::size_t> offsets;
+    std::vector<int> pivots;          // First literal of each clause, as read
+    std::vector<bool> active;
+    std::vector<bool> core;
+    std::vector<std::size_t> units;   // Active unit clauses
+    
+    std::size_t nformula;             // Clauses from the formula
+    
+    // Proof steps, up to the first empty clause: the clause index, or
+    // -(index + 1) for deletions. The active clauses are matched by hash.
+    std::vector<long> steps;
+    long emptyidx;                    // The empty clause (added if missing)
+    std::multimap<uint64_t, std::size_t> hashes;
+    
+    // Unit propagation over watched literals
+    int maxvar;
+    std::vector<signed char> values;
+    std::vector<long> reasons;
+    std::vector<bool> seen;
+    std::vector<int> trail;
+    std::size_t qhead;
+    std::vector<std::vector<std::size_t> > watches;
+    
+    // LRAT hints of each checked lemma (clause index + 1, negated for
+    // RAT candidates), back to back
+    std::vector<long> hints;
+    std::vector<std::pair<std::size_t, std::size_t> > hintranges;
+    std::vector<long> lemmahints;
+    
+    // Results
+    int result;
+    std::size_t nlemmas;
+    std::size_t ndeleted;
+    std::size_t nignored;
+    std::size_t nchecked;
+    std::size_t ncore;
+    std::size_t nrat;
+    long failedlemma;
+    std::vector<int> failedlits;
+    std::clock_t clockbegin;
+    std::clock_t clockend;
+};
+
+
+// Solves a stream of DIMACS formulas in one process, on a pool of worker
+// threads that keep their formula and solvers from one formula to the next.
+// A formula ends once the clauses announced by its problem line are read.
+// Each result is written as soon as it is known, as a line tagged with the
+// number of the formula in its stream (from 1):
+//   <number> <SATISFIABLE|UNSATISFIABLE|UNDEFINED|TIMEOUT|INVALID> <time> [<model> 0]
+// with the model (the assigned literals) only for satisfiable formulas.
+class Server {
+public:
+    Server();
+    virtual ~Server();
+    
+    // Getters / Setters (the workers take them when started)
+    int getnworkers() const;
+    void setnworkers(int nworkers);   // 0: one per core
+    double getmaxtime() const;
+    void setmaxtime(double secs);     // For each formula
+    bool iswatching() const;
+    void setwatching(bool watching);
+    bool ischoosing() const;
+    void setchoosing(bool choosing);  // Enumerating small formulas
+    bool issimplifying() const;
+    void setsimplifying(bool simplifying);
+    long getmaxprobes() const;
+    void setmaxprobes(long nprobes);  // Negative: the simplifier's default
+    std::size_t getnserved() const;
+    
+    bool start();
+    void stop();
+    
+    // Serves the formulas read from `infd`, writing the results to `outfd`.
+    // Returns once every result is written (started if needed).
+    bool serve(int infd, int outfd);
+    
+    // Serves every connection to a Unix socket created at `path`, each one
+    // as a stream of formulas, until SIGINT or SIGTERM. Returns true once
+    // stopped that way (the socket is removed, and the formulas already read
+    // are answered), false if the socket fails.
+    bool listen(const char* path);
+    
+protected:
+    struct Pool;
+    struct Stream;
+    struct Job;
+    
+    virtual void work();
+    virtual void submit(Stream& stream, std::size_t number, const std::string& text);
+    virtual Job* take();
+    virtual void reply(Job* job, const std::string& result);
+    
+    static void* runworker(void* server);
+    static void* runconnection(void* connection);
+    
+protected:
+    int nworkers;
+    double maxtime;
+    bool watching;
+    bool choosing;
+    bool simplifying;
+    long maxprobes;
+    Pool* pool;
+};
+
+
+// Solves every formula (*.cnf, *.dimacs) found under a directory, smallest
+// first, on a pool of worker threads that steal formulas from each other once
+// their own are done. As in `waf batch`, each formula is solved twice, by the
+// configured solver and by SimpleDpllSolver (as with `-W`), and written as a
+// CSV row in the format of cnfexec.py's `_writecsvcomp`:
+//   <opttime>; <chktime>; <deltatime>; <optcode>; <chkcode>; <path>
+// with the exit codes uksat would give for each run.
+class Batch {
+public:
+    Batch();
+    virtual ~Batch();
+    
+    // Getters / Setters
+    int getnworkers() const;
+    void setnworkers(int nworkers);   // 0: one per core
+    double getmaxtime() const;
+    void setmaxtime(double secs);     // For each run
+    bool iswatching() const;
+    void setwatching(bool watching);
+    bool ischoosing() const;
+    void setchoosing(bool choosing);
+    std::size_t getnformulas() const;
+    std::size_t getnstolen() const;
+    
+    // Finds the formulas in `path` (a directory, searched recursively, or a
+    // file), sorted by clauses and then vars as cnfstat.py sorts them
+    std::size_t find(const char* path);
+    
+    // Solves the formulas found, writing a row to `os` for each one as soon
+    // as it is solved
+    bool run(std::ostream& os);
+    
+protected:
+    struct Entry {
+        std::string path;
+        int nvars;
+        int nclauses;
+        bool operator<(const Entry& other) const;
+    };
+    struct Pool;
+    struct Worker;
+    
+    virtual void findfiles(const std::string& path);
+    virtual void addfile(const std::string& path);
+    virtual void work(std::size_t workeridx);
+    virtual bool take(std::size_t workeridx, std::size_t& entryidx);
+    
+    static void* runworker(void* worker);
+    
+protected:
+    int nworkers;
+    double maxtime;
+    bool watching;
+    bool choosing;
+    std::vector<Entry> entries;
+    std::size_t nstolen;
+    std::ostream* output;
+    Pool* pool;
 };
 
 };
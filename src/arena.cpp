@@ -0,0 +1,75 @@
+#include <algorithm>
+#include "uksat.hpp"
+
+// Bytes of the blocks carved by the arena
+#define uksat_ARENA_BLOCKBYTES (1 << 20)
+
+
+// Bytes of the chunks of a size class
+static std::size_t classbytes(std::size_t cls) {
+    return cls < uksat_ARENA_NSTEPS
+        ? (cls + 1) * uksat_ARENA_STEPBYTES
+        : static_cast<std::size_t>(2 * uksat_ARENA_STEPBYTES * uksat_ARENA_NSTEPS) << (cls - uksat_ARENA_NSTEPS);
+}
+
+
+uksat::Arena::Arena()
+: blockidx(0)
+, blockpos(0)
+, nlarge(0)
+{
+    std::fill(freechunks, freechunks + uksat_ARENA_NCLASSES, static_cast<void*>(NULL));
+}
+
+
+uksat::Arena::~Arena() {
+    for (std::size_t idx = 0; idx < blocks.size(); idx++) {
+        ::operator delete(blocks[idx]);
+    }
+}
+
+
+// Every chunk of the blocks is taken back, so the containers in the arena
+// must be gone already. The large chunks are given back to the heap by their
+// containers.
+void uksat::Arena::reset() {
+    blockidx = 0;
+    blockpos = 0;
+    std::fill(freechunks, freechunks + uksat_ARENA_NCLASSES, static_cast<void*>(NULL));
+}
+
+
+std::size_t uksat::Arena::getmemory() const {
+    return blocks.size() * uksat_ARENA_BLOCKBYTES + nlarge + memoryof(blocks);
+}
+
+
+// The next chunk of the class in the blocks, leaving the end of a block
+// unused when it doesn't fit, and taking a new block past the last one
+void* uksat::Arena::carve(std::size_t cls) {
+    std::size_t chunkbytes = classbytes(cls);
+
+    if (blocks.empty() || blockpos + chunkbytes > uksat_ARENA_BLOCKBYTES) {
+        if (!blocks.empty()) blockidx++;
+        if (blockidx == blocks.size()) {
+            blocks.push_back(static_cast<char*>(::operator new(uksat_ARENA_BLOCKBYTES)));
+        }
+        blockpos = 0;
+    }
+
+    void* chunk = blocks[blockidx] + blockpos;
+    blockpos += chunkbytes;
+    return chunk;
+}
+
+
+void* uksat::Arena::allocatelarge(std::size_t bytes) {
+    nlarge += bytes;
+    return ::operator new(bytes);
+}
+
+
+void uksat::Arena::releaselarge(void* chunk, std::size_t bytes) {
+    nlarge -= bytes;
+    ::operator delete(chunk);
+}
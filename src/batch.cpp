@@ -0,0 +1,335 @@
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "uksat.hpp"
+
+// The formulas left to a worker, smallest first. The worker takes them from
+// the front, and the others steal from the back.
+struct uksat::Batch::Worker {
+    Batch* batch;
+    std::size_t idx;
+    std::deque<std::size_t> entries;
+    std::size_t nstolen;
+    pthread_mutex_t mutex;
+};
+
+
+struct uksat::Batch::Pool {
+    std::vector<Worker> workers;
+    pthread_mutex_t mutex;      // Output rows
+};
+
+
+static bool hasextension(const std::string& name, const char* extension) {
+    std::size_t size = std::strlen(extension);
+    return name.size() > size && name.compare(name.size() - size, size, extension) == 0;
+}
+
+
+bool uksat::Batch::Entry::operator<(const Entry& other) const {
+    return nclauses != other.nclauses
+        ? nclauses < other.nclauses
+        : (nvars != other.nvars ? nvars < other.nvars : path < other.path);
+}
+
+
+uksat::Batch::Batch()
+: nworkers(0)
+, maxtime(0)
+, watching(true)
+, choosing(true)
+, nstolen(0)
+, output(NULL)
+, pool(NULL)
+{
+
+}
+
+
+uksat::Batch::~Batch() {
+
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters / Setters ]
+ */
+
+
+int uksat::Batch::getnworkers() const {
+    return nworkers;
+}
+
+
+void uksat::Batch::setnworkers(int _nworkers) {
+    nworkers = _nworkers;
+}
+
+
+double uksat::Batch::getmaxtime() const {
+    return maxtime;
+}
+
+
+void uksat::Batch::setmaxtime(double secs) {
+    maxtime = secs;
+}
+
+
+bool uksat::Batch::iswatching() const {
+    return watching;
+}
+
+
+void uksat::Batch::setwatching(bool _watching) {
+    watching = _watching;
+}
+
+
+bool uksat::Batch::ischoosing() const {
+    return choosing;
+}
+
+
+void uksat::Batch::setchoosing(bool _choosing) {
+    choosing = _choosing;
+}
+
+
+std::size_t uksat::Batch::getnformulas() const {
+    return entries.size();
+}
+
+
+std::size_t uksat::Batch::getnstolen() const {
+    return nstolen;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Finding formulas ]
+ */
+
+
+std::size_t uksat::Batch::find(const char* path) {
+    char resolved[PATH_MAX];
+    struct stat st;
+    std::string root(realpath(path, resolved) ? resolved : path);
+
+    // A file given by name is taken whatever its extension
+    entries.clear();
+    if (stat(root.c_str(), &st) != 0) {
+        return 0;
+    } else if (S_ISDIR(st.st_mode)) {
+        findfiles(root);
+    } else {
+        addfile(root);
+    }
+    std::sort(entries.begin(), entries.end());
+
+    return entries.size();
+}
+
+
+// Walks the directories as os.walk does, without following links to them
+void uksat::Batch::findfiles(const std::string& path) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) return;
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path.c_str());
+        struct dirent* dirent;
+
+        while (dir && (dirent = readdir(dir)) != NULL) {
+            std::string name(dirent->d_name);
+            if (name.compare(".") != 0 && name.compare("..") != 0) findfiles(path + "/" + name);
+        }
+        if (dir) closedir(dir);
+
+    } else if (hasextension(path, ".cnf") || hasextension(path, ".dimacs")) {
+        addfile(path);
+    }
+}
+
+
+// Only the problem line is read, for the size of the formula
+void uksat::Batch::addfile(const std::string& path) {
+    Entry entry;
+    std::ifstream file(path.c_str());
+    std::string line;
+
+    entry.path = path;
+    entry.nvars = entry.nclauses = 0;
+    while (std::getline(file, line)) {
+        std::size_t pos = line.find_first_not_of(" \t\r");
+        if (pos != std::string::npos && line[pos] == 'p') {
+            std::istringstream ss(line.substr(pos));
+            std::string tname;
+            ss >> tname >> tname >> entry.nvars >> entry.nclauses;
+            break;
+        }
+    }
+
+    entries.push_back(entry);
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Solving ]
+ */
+
+
+// The formulas are dealt to the workers in turns, so that each one starts
+// with formulas of every size
+bool uksat::Batch::run(std::ostream& os) {
+    long nthreads = nworkers > 0 ? nworkers : sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = std::max(1L, std::min<long>(nthreads, entries.size()));
+
+    // Same header as `_writecsvheader`, labels included
+    os << "# chktime; opttime; deltatime; optcode; chkcode; filename" << std::endl;
+
+    output = &os;
+    nstolen = 0;
+    pool = new Pool();
+    pool->workers.resize(nthreads);
+    pthread_mutex_init(&pool->mutex, NULL);
+
+    for (long idx = 0; idx < nthreads; idx++) {
+        Worker& worker = pool->workers[idx];
+        worker.batch = this;
+        worker.idx = idx;
+        worker.nstolen = 0;
+        pthread_mutex_init(&worker.mutex, NULL);
+    }
+    for (std::size_t idx = 0; idx < entries.size(); idx++) {
+        pool->workers[idx % nthreads].entries.push_back(idx);
+    }
+
+    // The first worker runs in this thread, and the formulas of workers that
+    // couldn't be started are stolen by the others
+    std::vector<pthread_t> threads(nthreads);
+    std::vector<bool> started(nthreads, false);
+    for (long idx = 1; idx < nthreads; idx++) {
+        started[idx] = pthread_create(&threads[idx], NULL, runworker, &pool->workers[idx]) == 0;
+    }
+    runworker(&pool->workers[0]);
+    for (long idx = 1; idx < nthreads; idx++) {
+        if (started[idx]) pthread_join(threads[idx], NULL);
+    }
+
+    for (long idx = 0; idx < nthreads; idx++) {
+        nstolen += pool->workers[idx].nstolen;
+        pthread_mutex_destroy(&pool->workers[idx].mutex);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    delete pool;
+    pool = NULL;
+    output = NULL;
+
+    return os.good();
+}
+
+
+void* uksat::Batch::runworker(void* data) {
+    Worker& worker = *static_cast<Worker*>(data);
+    worker.batch->work(worker.idx);
+    return NULL;
+}
+
+
+// Each worker keeps its formula and its solvers, cleared for every run. The
+// codes are 0 for formulas that can't be loaded.
+void uksat::Batch::work(std::size_t workeridx) {
+    CnfFormula formula;
+    SolverCache solvers(formula);
+    std::size_t entryidx;
+
+    formula.setnthreads(1);
+    solvers.setmaxtime(maxtime);
+
+    while (take(workeridx, entryidx)) {
+        double opttime = 0;
+        double chktime = 0;
+        int optcode = 0;
+        int chkcode = 0;
+
+        if (formula.openfile(entries[entryidx].path.c_str())) {
+            Solver& optsolver = solvers.get(choosesolver(formula, choosing, watching));
+            optsolver.clear();
+            optsolver.query();
+            opttime = optsolver.getelapsedtime();
+            optcode = resultcode(optsolver);
+
+            Solver& chksolver = solvers.get(SOLVER_SIMPLE);
+            chksolver.clear();
+            chksolver.query();
+            chktime = chksolver.getelapsedtime();
+            chkcode = resultcode(chksolver);
+        }
+
+        std::ostringstream row;
+        row << std::fixed << std::setprecision(6)
+            << opttime << "; " << chktime << "; " << (chktime - opttime) << "; "
+            << optcode << "; " << chkcode << "; " << entries[entryidx].path << "\n";
+
+        pthread_mutex_lock(&pool->mutex);
+        *output << row.str() << std::flush;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+
+// The next formula of the worker or, once it has none left, the largest one
+// left to the worker with the most formulas
+bool uksat::Batch::take(std::size_t workeridx, std::size_t& entryidx) {
+    Worker& self = pool->workers[workeridx];
+    bool found = false;
+
+    pthread_mutex_lock(&self.mutex);
+    if (!self.entries.empty()) {
+        entryidx = self.entries.front();
+        self.entries.pop_front();
+        found = true;
+    }
+    pthread_mutex_unlock(&self.mutex);
+
+    while (!found) {
+        std::size_t victimidx = pool->workers.size();
+        std::size_t nmost = 0;
+
+        for (std::size_t idx = 0; idx < pool->workers.size(); idx++) {
+            Worker& worker = pool->workers[idx];
+            pthread_mutex_lock(&worker.mutex);
+            if (worker.entries.size() > nmost) {
+                nmost = worker.entries.size();
+                victimidx = idx;
+            }
+            pthread_mutex_unlock(&worker.mutex);
+        }
+        if (victimidx == pool->workers.size()) break;
+
+        Worker& victim = pool->workers[victimidx];
+        pthread_mutex_lock(&victim.mutex);
+        if (!victim.entries.empty()) {
+            entryidx = victim.entries.back();
+            victim.entries.pop_back();
+            self.nstolen++;
+            found = true;
+        }
+        pthread_mutex_unlock(&victim.mutex);
+    }
+
+    return found;
+}
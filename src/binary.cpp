@@ -0,0 +1,203 @@
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "uksat.hpp"
+
+// Increased whenever the layout changes, so that old caches are rejected
+#define uksat_BINARY_VERSION 2
+
+// FNV-1a, over the 64-bit words of the sections
+#define uksat_BINARY_HASHBASIS UINT64_C(14695981039346656037)
+#define uksat_BINARY_HASHPRIME UINT64_C(1099511628211)
+
+// Rounds a size in bytes up to the 8-byte alignment of every section
+#define uksat_BINARY_ALIGN(n) (((n) + 7) & ~static_cast<std::size_t>(7))
+
+
+// Fixed-size start of a binary formula, followed by the sections: clause
+// offsets (uint64_t), the literal arena (int32_t), the literal frequencies
+// (int32_t, by uksat_LITIDX) and the var order (int32_t), each one padded to
+// 8 bytes. Everything is in the native byte order: the file is a cache of the
+// DIMACS formula for the same machine, not an exchange format.
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t nvars;
+    int32_t nclauses;
+    uint64_t nliterals;
+    uint64_t nfrequencies;
+    uint64_t norder;
+    uint64_t hash;          // Of all the sections
+};
+
+
+static uint64_t hashwords(const char* data, std::size_t size) {
+    uint64_t hash = uksat_BINARY_HASHBASIS;
+    for (std::size_t pos = 0; pos < size; pos += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + pos, 8);
+        hash = (hash ^ word) * uksat_BINARY_HASHPRIME;
+    }
+    return hash;
+}
+
+
+static std::size_t sectionsize(const BinaryHeader& header) {
+    return 8 * (static_cast<std::size_t>(header.nclauses) + 1)
+        + uksat_BINARY_ALIGN(4 * header.nliterals)
+        + uksat_BINARY_ALIGN(4 * header.nfrequencies)
+        + uksat_BINARY_ALIGN(4 * header.norder);
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Binary formulas ]
+ */
+
+
+// Cardinality constraints have no section, formulas with them aren't saved
+bool uksat::CnfFormula::savebinary(std::ostream& os) {
+    bool ret = false;
+
+    if (os.good() && nvars && nclauses && cardbounds.empty()) {
+        BinaryHeader header;
+        std::memcpy(header.magic, uksat_BINARYMAGIC, 4);
+        header.version = uksat_BINARY_VERSION;
+        header.nvars = nvars;
+        header.nclauses = nclauses;
+        header.nliterals = literals.size();
+        header.nfrequencies = frequencies.size();
+        header.norder = varorder.size();
+
+        std::vector<char> data(sectionsize(header), 0);
+        char* pos = &data[0];
+
+        for (std::vector<std::size_t>::const_iterator it = offsets.begin(); it != offsets.end(); ++it, pos += 8) {
+            uint64_t offset = *it;
+            std::memcpy(pos, &offset, 8);
+        }
+
+        if (!literals.empty()) std::memcpy(pos, &literals[0], 4 * literals.size());
+        pos += uksat_BINARY_ALIGN(4 * literals.size());
+
+        if (!frequencies.empty()) std::memcpy(pos, &frequencies[0], 4 * frequencies.size());
+        pos += uksat_BINARY_ALIGN(4 * frequencies.size());
+
+        if (!varorder.empty()) std::memcpy(pos, &varorder[0], 4 * varorder.size());
+
+        header.hash = hashwords(&data[0], data.size());
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(&data[0], data.size());
+        ret = os.good();
+    }
+
+    return ret;
+}
+
+
+// Maps the file if it starts with the binary magic. Returns 1 if it was
+// loaded, -1 if it's a binary formula that couldn't be loaded, and 0 if it
+// isn't one (or can't be mapped), so that the caller reads it as text.
+int uksat::CnfFormula::mapbinary(const char* filename) {
+    int ret = 0;
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+
+    if (fd >= 0 && fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(BinaryHeader)) {
+        char magic[4];
+
+        if (pread(fd, magic, 4, 0) == 4 && std::memcmp(magic, uksat_BINARYMAGIC, 4) == 0) {
+            std::size_t size = static_cast<std::size_t>(st.st_size);
+            void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (data != MAP_FAILED) {
+                madvise(data, size, MADV_SEQUENTIAL);
+                ret = openbinary(static_cast<const char*>(data), size) ? 1 : -1;
+                munmap(data, size);
+            }
+        }
+    }
+
+    if (fd >= 0) close(fd);
+    return ret;
+}
+
+
+bool uksat::CnfFormula::readbinary(std::istream& is) {
+    std::vector<char> bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+    // Copied to 8-byte aligned storage, as the sections are read in place
+    std::vector<uint64_t> data(bytes.size() / 8 + 1);
+    if (!bytes.empty()) std::memcpy(&data[0], &bytes[0], bytes.size());
+
+    return openbinary(reinterpret_cast<const char*>(&data[0]), bytes.size());
+}
+
+
+// Loads the formula from a whole binary file in memory (8-byte aligned).
+// The sections are copied as they are, without building anything again.
+bool uksat::CnfFormula::openbinary(const char* data, std::size_t size) {
+    bool ret = false;
+    BinaryHeader header;
+
+    nvars = 0;
+    nclauses = 0;
+    literals.clear();
+    offsets.assign(1, 0);
+    frequencies.clear();
+    varorder.clear();
+    clearcardinalities();
+
+    if (size >= sizeof(header)) {
+        std::memcpy(&header, data, sizeof(header));
+        data += sizeof(header);
+        size -= sizeof(header);
+
+        ret = std::memcmp(header.magic, uksat_BINARYMAGIC, 4) == 0
+            && header.version == uksat_BINARY_VERSION
+            && header.nvars > 0 && header.nclauses > 0
+            && header.nliterals < (static_cast<uint64_t>(1) << 40)
+            && header.nfrequencies <= 2 * static_cast<uint64_t>(header.nvars) + 2
+            && header.norder <= static_cast<uint64_t>(header.nvars)
+            && sectionsize(header) == size
+            && hashwords(data, size) == header.hash;
+    }
+
+    if (ret) {
+        const uint64_t* offsetdata = reinterpret_cast<const uint64_t*>(data);
+        const int32_t* literaldata = reinterpret_cast<const int32_t*>(data + 8 * (header.nclauses + 1));
+        const int32_t* frequencydata = reinterpret_cast<const int32_t*>(
+            reinterpret_cast<const char*>(literaldata) + uksat_BINARY_ALIGN(4 * header.nliterals));
+        const int32_t* orderdata = reinterpret_cast<const int32_t*>(
+            reinterpret_cast<const char*>(frequencydata) + uksat_BINARY_ALIGN(4 * header.nfrequencies));
+
+        // Same constraints as the text parser: no empty clauses, and no vars
+        // outside of the problem space
+        ret = offsetdata[0] == 0 && offsetdata[header.nclauses] == header.nliterals;
+        for (int32_t idx = 0; ret && idx < header.nclauses; idx++) {
+            ret = offsetdata[idx] < offsetdata[idx + 1];
+        }
+        for (uint64_t idx = 0; ret && idx < header.nliterals; idx++) {
+            ret = literaldata[idx] && literaldata[idx] >= -header.nvars && literaldata[idx] <= header.nvars;
+        }
+        for (uint64_t idx = 0; ret && idx < header.norder; idx++) {
+            ret = orderdata[idx] && orderdata[idx] >= -header.nvars && orderdata[idx] <= header.nvars;
+        }
+
+        if (ret) {
+            nvars = header.nvars;
+            nclauses = header.nclauses;
+            offsets.assign(offsetdata, offsetdata + header.nclauses + 1);
+            literals.assign(literaldata, literaldata + header.nliterals);
+            frequencies.assign(frequencydata, frequencydata + header.nfrequencies);
+            varorder.assign(orderdata, orderdata + header.norder);
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,193 @@
+
+#include <iostream>
+#include "uksat.hpp"
+
+// Formulas with more (occurring) vars than this are not enumerated; past the
+// default limit, DPLL is usually faster than the 2^n enumeration
+#define uksat_BRUTEFORCE_MAXVARS 24
+#define uksat_BRUTEFORCE_DEFVARS 16
+
+// Vars whose values change inside a word (2^6 = 64 assignments per word)
+#define uksat_BRUTEFORCE_WORDVARS 6
+
+// How many words are evaluated between two time checks
+#define uksat_BRUTEFORCE_TIMESTEP 1024
+
+
+// Bit masks of the first uksat_BRUTEFORCE_WORDVARS var positions, in which
+// bit `j` of a word is the value of the var for the `j`-th assignment
+static const uint64_t wordmasks[uksat_BRUTEFORCE_WORDVARS] = {
+    (static_cast<uint64_t>(0xAAAAAAAAUL) << 32) | 0xAAAAAAAAUL,
+    (static_cast<uint64_t>(0xCCCCCCCCUL) << 32) | 0xCCCCCCCCUL,
+    (static_cast<uint64_t>(0xF0F0F0F0UL) << 32) | 0xF0F0F0F0UL,
+    (static_cast<uint64_t>(0xFF00FF00UL) << 32) | 0xFF00FF00UL,
+    (static_cast<uint64_t>(0xFFFF0000UL) << 32) | 0xFFFF0000UL,
+    (static_cast<uint64_t>(0xFFFFFFFFUL) << 32)
+};
+
+
+uksat::BruteForceSolver::BruteForceSolver(CnfFormula& _formula)
+: Solver::Solver(_formula)
+, maxvars(uksat_BRUTEFORCE_DEFVARS)
+, nwords(0)
+, nclausereads(0)
+{
+    
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters/Setters ]
+ */
+
+
+int uksat::BruteForceSolver::getmaxvars() const {
+    return maxvars;
+}
+
+
+void uksat::BruteForceSolver::setmaxvars(int _maxvars) {
+    if (_maxvars >= 0 && _maxvars <= uksat_BRUTEFORCE_MAXVARS) maxvars = _maxvars;
+}
+
+
+// Only clauses are evaluated, formulas with cardinality constraints are left
+// to DPLL
+bool uksat::BruteForceSolver::isfeasible() const {
+    return formula.isvalid() && !formula.getncardinalities()
+        && formula.getvarorder().size() <= static_cast<std::size_t>(maxvars);
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Solving ]
+ */
+
+
+bool uksat::BruteForceSolver::query() {
+    start();
+    
+    if (isstarted()) {
+        load();
+        
+        if (!isfeasible()) {
+            finish(0);
+            
+        } else {
+            std::size_t nvars = vars.size();
+            uint64_t lastword = nvars > uksat_BRUTEFORCE_WORDVARS
+                ? (static_cast<uint64_t>(1) << (nvars - uksat_BRUTEFORCE_WORDVARS))
+                : 1;
+            
+            for (uint64_t word = 0; word < lastword && !isfinished(); word++) {
+                if (!(word % uksat_BRUTEFORCE_TIMESTEP) && !intime()) {
+                    finish(0);
+                    
+                } else {
+                    uint64_t models = evaluate(word);
+                    if (models) {
+                        assign(word, models);
+                        finish(1);
+                    }
+                }
+            }
+            
+            if (!isfinished()) finish(-1);
+        }
+    }
+    
+    return issatisfied();
+}
+
+
+void uksat::BruteForceSolver::printstats(std::ostream& os) {
+    Solver::printstats(os);
+    os << "\tvars: " << vars.size() << std::endl;
+    os << "\twords: " << nwords << std::endl;
+    os << "\tclausereads: " << nclausereads << std::endl;
+}
+
+
+std::size_t uksat::BruteForceSolver::getmemory() const {
+    return Solver::getmemory() + memoryof(vars) + memoryof(clauses);
+}
+
+
+void uksat::BruteForceSolver::clear() {
+    Solver::clear();
+    vars.clear();
+    clauses.clear();
+    nwords = nclausereads = 0;
+}
+
+
+void uksat::BruteForceSolver::load() {
+    std::vector<int> positions(formula.getnvars() + 1, -1);
+    vars.clear();
+    clauses.clear();
+    nwords = nclausereads = 0;
+    
+    if (!isfeasible()) return;
+    
+    for (std::vector<int>::const_iterator it = formula.getvarorder().begin(); it != formula.getvarorder().end(); ++it) {
+        int var = uksat_NORMALLIT(*it);
+        if (positions[var] < 0) {
+            positions[var] = vars.size();
+            vars.push_back(var);
+        }
+    }
+    
+    clauses.resize(formula.getnclauses());
+    for (std::size_t clauseidx = 0; clauseidx < static_cast<std::size_t>(formula.getnclauses()); clauseidx++) {
+        CnfFormula::Clause clause = formula[clauseidx];
+        std::vector<int>& lits = clauses[clauseidx];
+        lits.reserve(clause.size());
+        
+        for (CnfFormula::Clause::const_iterator it = clause.begin(); it != clause.end(); ++it) {
+            int lit = *it;
+            lits.push_back(2 * positions[uksat_NORMALLIT(lit)] + (lit < 0 ? 1 : 0));
+        }
+    }
+}
+
+
+uint64_t uksat::BruteForceSolver::evaluate(uint64_t word) {
+    std::size_t nvars = vars.size();
+    uint64_t models = ~static_cast<uint64_t>(0);
+    
+    // Less than 64 assignments, only the first 2^nvars bits are valid
+    if (nvars < uksat_BRUTEFORCE_WORDVARS)
+        models >>= 64 - (static_cast<std::size_t>(1) << nvars);
+    
+    nwords++;
+    for (std::size_t clauseidx = 0; clauseidx < clauses.size() && models; clauseidx++) {
+        const std::vector<int>& lits = clauses[clauseidx];
+        uint64_t clausemodels = 0;
+        nclausereads++;
+        
+        for (std::vector<int>::const_iterator it = lits.begin(); it != lits.end(); ++it) {
+            int pos = *it >> 1;
+            uint64_t mask = pos < uksat_BRUTEFORCE_WORDVARS
+                ? wordmasks[pos]
+                : ((word >> (pos - uksat_BRUTEFORCE_WORDVARS)) & 1) ? ~static_cast<uint64_t>(0) : 0;
+            clausemodels |= (*it & 1) ? ~mask : mask;
+        }
+        
+        models &= clausemodels;
+    }
+    
+    return models;
+}
+
+
+void uksat::BruteForceSolver::assign(uint64_t word, uint64_t models) {
+    std::size_t bit = 0;
+    while (!((models >> bit) & 1)) bit++;
+    
+    for (std::size_t pos = 0; pos < vars.size(); pos++) {
+        bool truth = pos < uksat_BRUTEFORCE_WORDVARS
+            ? ((bit >> pos) & 1)
+            : ((word >> (pos - uksat_BRUTEFORCE_WORDVARS)) & 1);
+        partial.assign(vars[pos], truth);
+    }
+}
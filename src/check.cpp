@@ -0,0 +1,176 @@
+
+#include <algorithm>
+#include "uksat.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define uksat_CHECK_AVX2 1
+#   include <immintrin.h>
+#endif
+
+// Number of literals evaluated at once by the model check
+#define uksat_CHECK_BLOCKSIZE 2048
+
+
+// Evaluates the literals in [begin, end), setting their bits in `satbits`
+// (literal true) or `undefbits` (var unassigned)
+static void evalliterals(const int* lits, std::size_t begin, std::size_t end, const int* vals,
+        uint64_t* satbits, uint64_t* undefbits) {
+    for (std::size_t idx = begin; idx < end; idx++) {
+        int lit = lits[idx];
+        int val = vals[uksat_NORMALLIT(lit)];
+        uint64_t bit = static_cast<uint64_t>(1) << (idx & 63);
+        
+        if (lit < 0 ? val < 0 : val > 0) {
+            satbits[idx >> 6] |= bit;
+        } else if (!val) {
+            undefbits[idx >> 6] |= bit;
+        }
+    }
+}
+
+
+#ifdef uksat_CHECK_AVX2
+// Same as evalliterals, gathering the values of 8 literals at a time
+__attribute__((target("avx2")))
+static void evalliterals_avx2(const int* lits, std::size_t nlits, const int* vals,
+        uint64_t* satbits, uint64_t* undefbits) {
+    const __m256i zero = _mm256_setzero_si256();
+    std::size_t idx = 0;
+    
+    for (; idx + 8 <= nlits; idx += 8) {
+        __m256i lit = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lits + idx));
+        __m256i val = _mm256_i32gather_epi32(vals, _mm256_abs_epi32(lit), 4);
+        __m256i sat = _mm256_cmpgt_epi32(_mm256_sign_epi32(val, lit), zero);
+        __m256i undef = _mm256_cmpeq_epi32(val, zero);
+        uint64_t satmask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(sat)));
+        uint64_t undefmask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(undef)));
+        satbits[idx >> 6] |= satmask << (idx & 63);
+        undefbits[idx >> 6] |= undefmask << (idx & 63);
+    }
+    
+    evalliterals(lits, idx, nlits, vals, satbits, undefbits);
+}
+
+
+static bool hasavx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+
+// Checks whether any bit in [begin, end) is set
+static bool anybit(const uint64_t* bits, std::size_t begin, std::size_t end) {
+    while (begin < end) {
+        std::size_t shift = begin & 63;
+        std::size_t nbits = std::min<std::size_t>(64 - shift, end - begin);
+        uint64_t mask = nbits == 64 ? ~static_cast<uint64_t>(0) : ((static_cast<uint64_t>(1) << nbits) - 1);
+        if (bits[begin >> 6] & (mask << shift)) return true;
+        begin += nbits;
+    }
+    return false;
+}
+
+
+// Checks the formula against the var values (as in PartialMap, index = var - 1).
+// Returns 1 if all clauses are satisfied, -1 if some clause is falsified and
+// 0 otherwise (some clause has only false and unassigned literals).
+// Literals are evaluated a block of clauses at a time, so that a falsified
+// clause stops the check early. Cardinality constraints are checked the same
+// way: falsified with too many true literals, and undefined while the
+// unassigned ones could still make too many.
+int uksat::CnfFormula::check(const std::vector<signed char>& values) const {
+    std::vector<int> vals(nvars + 1, 0);
+    std::vector<uint64_t> satbits;
+    std::vector<uint64_t> undefbits;
+    int truth = 1;
+    
+    for (std::size_t var = 1; var <= values.size() && var < vals.size(); var++) {
+        vals[var] = values[var - 1];
+    }
+    
+    int blockidx = 0;
+    while (blockidx < nclauses && truth >= 0) {
+        std::size_t base = offsets[blockidx];
+        int endidx = blockidx;
+        while (endidx < nclauses && offsets[endidx] - base < uksat_CHECK_BLOCKSIZE) endidx++;
+        
+        std::size_t nlits = offsets[endidx] - base;
+        std::size_t nwords = nlits / 64 + 1;
+        satbits.assign(nwords, 0);
+        undefbits.assign(nwords, 0);
+        
+        if (nlits) {
+#ifdef uksat_CHECK_AVX2
+            if (hasavx2())
+                evalliterals_avx2(&literals[base], nlits, &vals[0], &satbits[0], &undefbits[0]);
+            else
+#endif
+                evalliterals(&literals[base], 0, nlits, &vals[0], &satbits[0], &undefbits[0]);
+        }
+        
+        for (int clauseidx = blockidx; clauseidx < endidx && truth >= 0; clauseidx++) {
+            std::size_t begin = offsets[clauseidx] - base;
+            std::size_t end = offsets[clauseidx + 1] - base;
+            
+            if (!anybit(&satbits[0], begin, end)) {
+                truth = anybit(&undefbits[0], begin, end) ? 0 : -1;
+            }
+        }
+        
+        blockidx = endidx;
+    }
+    
+    for (std::size_t cardidx = 0; cardidx < cardbounds.size() && truth >= 0; cardidx++) {
+        Clause card = getcardinality(cardidx);
+        int ntrue = 0;
+        int nundefs = 0;
+        
+        for (Clause::const_iterator it = card.begin(); it != card.end(); ++it) {
+            int val = vals[uksat_NORMALLIT(*it)];
+            if (*it < 0 ? val < 0 : val > 0) ntrue++;
+            else if (!val) nundefs++;
+        }
+        
+        if (ntrue > cardbounds[cardidx]) truth = -1;
+        else if (ntrue + nundefs > cardbounds[cardidx]) truth = 0;
+    }
+    
+    return truth;
+}
+
+
+// Checks up to 64 complete models at once. `models[var]` holds the value of
+// `var` in each model, one bit per model, for vars 1 to nvars (the word at 0
+// is unused). Returns the bits of the models satisfying every clause.
+uint64_t uksat::CnfFormula::check(const std::vector<uint64_t>& models) const {
+    uint64_t satmodels = ~static_cast<uint64_t>(0);
+    
+    for (int clauseidx = 0; clauseidx < nclauses && satmodels; clauseidx++) {
+        Clause clause = (*this)[clauseidx];
+        uint64_t clausemodels = 0;
+        
+        for (Clause::const_iterator it = clause.begin(); it != clause.end(); ++it) {
+            uint64_t mask = models[uksat_NORMALLIT(*it)];
+            clausemodels |= *it < 0 ? ~mask : mask;
+        }
+        
+        satmodels &= clausemodels;
+    }
+    
+    // Cardinality constraints, one model at a time
+    for (std::size_t cardidx = 0; cardidx < cardbounds.size() && satmodels; cardidx++) {
+        Clause card = getcardinality(cardidx);
+        
+        for (std::size_t bit = 0; bit < 64; bit++) {
+            int ntrue = 0;
+            for (Clause::const_iterator it = card.begin(); it != card.end(); ++it) {
+                bool value = (models[uksat_NORMALLIT(*it)] >> bit) & 1;
+                if (*it < 0 ? !value : value) ntrue++;
+            }
+            if (ntrue > cardbounds[cardidx]) satmodels &= ~(static_cast<uint64_t>(1) << bit);
+        }
+    }
+    
+    return satmodels;
+}
@@ -0,0 +1,70 @@
+#include "uksat.hpp"
+
+
+uksat::SolverTypeId uksat::choosesolver(CnfFormula& formula, bool choosing, bool watching) {
+    if (choosing && BruteForceSolver(formula).isfeasible()) return SOLVER_BRUTEFORCE;
+    return watching ? SOLVER_WATCHED : SOLVER_SIMPLE;
+}
+
+
+uksat::Solver* uksat::newsolver(CnfFormula& formula, SolverTypeId type) {
+    switch (type) {
+        case SOLVER_WATCHED:    return new WatchedDpllSolver(formula);
+        case SOLVER_BRUTEFORCE: return new BruteForceSolver(formula);
+        case SOLVER_COUNTING:   return new CountingSolver(formula);
+        case SOLVER_LOOKAHEAD:  return new LookaheadSolver(formula);
+        default:                return new SimpleDpllSolver(formula);
+    }
+}
+
+
+const char* uksat::resultname(const Solver& solver) {
+    if (solver.hasmemout()) return "MEMOUT";
+    if (solver.hastimeout()) return "TIMEOUT";
+    if (solver.issatisfied()) return "SATISFIABLE";
+    if (solver.isconflicting()) return "UNSATISFIABLE";
+    return "UNDEFINED";
+}
+
+
+int uksat::resultcode(const Solver& solver) {
+    if (solver.hasmemout()) return uksat_UNDEFCODE;
+    if (solver.hastimeout()) return uksat_TIMEOUTCODE;
+    if (solver.issatisfied()) return uksat_SATCODE;
+    if (solver.isconflicting()) return uksat_UNSATCODE;
+    return uksat_UNDEFCODE;
+}
+
+
+uksat::SolverCache::SolverCache(CnfFormula& _formula)
+: formula(_formula)
+, maxtime(0)
+, solvers(SOLVER__MAX + 1, static_cast<Solver*>(NULL))
+{
+
+}
+
+
+uksat::SolverCache::~SolverCache() {
+    for (std::size_t idx = 0; idx < solvers.size(); idx++) {
+        delete solvers[idx];
+    }
+}
+
+
+void uksat::SolverCache::setmaxtime(double secs) {
+    maxtime = secs;
+    for (std::size_t idx = 0; idx < solvers.size(); idx++) {
+        if (solvers[idx]) solvers[idx]->setmaxtime(secs);
+    }
+}
+
+
+uksat::Solver& uksat::SolverCache::get(SolverTypeId type) {
+    Solver*& solver = solvers[type];
+    if (!solver) {
+        solver = newsolver(formula, type);
+        solver->setmaxtime(maxtime);
+    }
+    return *solver;
+}
@@ -8,28 +8,25 @@
 
 #include "uksat.hpp"
 
-static bool varfreq_less(const std::pair<int, int>& a, const std::pair<int, int>& b) {
-    int norm_a = uksat_NORMALLIT(a.first);
-    int norm_b = uksat_NORMALLIT(b.first);
-    return b.second < a.second || (b.second == a.second && norm_a < norm_b);
-}
 
-struct VarFreq_Less {
-    bool operator()(const std::pair<int, int>& a, const std::pair<int, int>& b) {
-        return varfreq_less(a, b);
+// Counts the literals in [begin, end) in the frequencies, grown as needed
+static void countliterals(std::vector<int>& frequencies, const int* begin, const int* end) {
+    for (const int* it = begin; it != end; ++it) {
+        std::size_t idx = uksat_LITIDX(*it);
+        if (idx >= frequencies.size()) frequencies.resize(std::max(idx + 2, 2 * frequencies.size()), 0);
+        frequencies[idx]++;
     }
-};
+}
+
 
-uksat::CnfFormula::CnfFormula() : nvars(0), nclauses(0) {
+uksat::CnfFormula::CnfFormula() : nvars(0), nclauses(0), offsets(1, 0), nthreads(0), cardoffsets(1, 0) {
 
 }
 
 
-uksat::CnfFormula::CnfFormula(unsigned int numvars, std::vector<std::vector<int> >& clist) {
+uksat::CnfFormula::CnfFormula(unsigned int numvars, std::vector<std::vector<int> >& clist) : nvars(0), nclauses(0), offsets(1, 0), nthreads(0), cardoffsets(1, 0) {
 	if (numvars > 0) {
-		nvars = numvars;
-		clauses = clist;
-		nclauses = clauses.size();
+		setclauses(numvars, clist);
 	}
 }
 
@@ -44,6 +41,11 @@ int uksat::CnfFormula::getnclauses() const {
 }
 
 
+int uksat::CnfFormula::getncardinalities() const {
+    return cardbounds.size();
+}
+
+
 int uksat::CnfFormula::totalfrequency(int normvar) const {
     int normalizedvar = uksat_NORMALLIT(normvar);
     return frequency(normalizedvar) + frequency(-normalizedvar);
@@ -51,10 +53,8 @@ int uksat::CnfFormula::totalfrequency(int normvar) const {
 
 
 int uksat::CnfFormula::frequency(int var) const {
-    std::map<int, int>::const_iterator var_it = varfrequencies.find(var);
-    int total = 0;
-    if (var_it != varfrequencies.end())  total = var_it->second;
-    return total;
+    std::size_t idx = uksat_LITIDX(var);
+    return idx < frequencies.size() ? frequencies[idx] : 0;
 }
 
 
@@ -63,12 +63,94 @@ const std::vector<int>& uksat::CnfFormula::getvarorder() const {
 }
 
 
-const std::vector<int>& uksat::CnfFormula::operator[](int clauseidx) const {
-	return clauses[clauseidx];
+uksat::CnfFormula::Clause uksat::CnfFormula::operator[](int clauseidx) const {
+    const int* base = literals.empty() ? NULL : &literals[0];
+	return Clause(base + offsets[clauseidx], base + offsets[clauseidx + 1]);
+}
+
+
+// The literals of a cardinality constraint, at most `getbound` of them true
+uksat::CnfFormula::Clause uksat::CnfFormula::getcardinality(int cardidx) const {
+    const int* base = cardliterals.empty() ? NULL : &cardliterals[0];
+    return Clause(base + cardoffsets[cardidx], base + cardoffsets[cardidx + 1]);
+}
+
+
+int uksat::CnfFormula::getbound(int cardidx) const {
+    return cardbounds[cardidx];
 }
 
+
+const std::vector<int>& uksat::CnfFormula::getliterals() const {
+    return literals;
+}
+
+
+const std::vector<std::size_t>& uksat::CnfFormula::getoffsets() const {
+    return offsets;
+}
+
+
+// Bytes of the clause arena and the constraints, with the literal counts
+std::size_t uksat::CnfFormula::getmemory() const {
+    return memoryof(literals) + memoryof(offsets) + memoryof(frequencies) + memoryof(varorder)
+        + memoryof(cardliterals) + memoryof(cardoffsets) + memoryof(cardbounds);
+}
+
+
 bool uksat::CnfFormula::isvalid() const {
-	return nvars > 0 && nclauses > 0 && nclauses == clauses.size();
+	return nvars > 0 && (nclauses > 0 || !cardbounds.empty()) && nclauses == offsets.size() - 1;
+}
+
+
+void uksat::CnfFormula::setclauses(int numvars, const std::vector<std::vector<int> >& clist) {
+    nvars = numvars;
+    nclauses = clist.size();
+    literals.clear();
+    offsets.assign(1, 0);
+    frequencies.assign(uksat_LITIDX(-numvars) + 1, 0);
+    varorder.clear();
+    clearcardinalities();
+
+    for (std::vector<std::vector<int> >::const_iterator clause = clist.begin(); clause != clist.end(); ++clause) {
+        for (std::vector<int>::const_iterator var = clause->begin(); var != clause->end(); ++var) {
+            std::size_t idx = uksat_LITIDX(*var);
+            if (idx >= frequencies.size()) frequencies.resize(idx + 1, 0);
+            literals.push_back(*var);
+            frequencies[idx]++;
+        }
+        offsets.push_back(literals.size());
+    }
+
+    buildvarorder();
+}
+
+
+// Adds the constraint that at most `bound` of the literals are true (none of
+// them if the bound is negative, and then the formula is unsatisfiable).
+// Returns false if some literal isn't in the problem space.
+bool uksat::CnfFormula::addcardinality(const std::vector<int>& lits, int bound) {
+    bool ret = nvars > 0 && !lits.empty();
+    for (std::vector<int>::const_iterator it = lits.begin(); ret && it != lits.end(); ++it) {
+        ret = *it && *it >= -nvars && *it <= nvars;
+    }
+
+    if (ret) {
+        cardliterals.insert(cardliterals.end(), lits.begin(), lits.end());
+        cardoffsets.push_back(cardliterals.size());
+        cardbounds.push_back(bound);
+        countliterals(frequencies, &lits[0], &lits[0] + lits.size());
+        buildvarorder();
+    }
+
+    return ret;
+}
+
+
+void uksat::CnfFormula::clearcardinalities() {
+    cardliterals.clear();
+    cardoffsets.assign(1, 0);
+    cardbounds.clear();
 }
 
 
@@ -76,8 +158,20 @@ bool uksat::CnfFormula::openfile(const char* filename) {
 	bool ret = false;
 
 	if (filename) {
+        // Binary formulas are mapped, compressed ones are decompressed as
+        // they are read, and the rest are mapped and parsed in parallel
+        int loaded = mapbinary(filename);
 		std::ifstream file;
-		file.open(filename);
+
+        if (!loaded) loaded = opencompressed(filename);
+        if (!loaded) loaded = mapdimacs(filename);
+
+        if (loaded) {
+            ret = loaded > 0;
+
+        } else {
+            file.open(filename);
+        }
 
 		if (file.is_open()) {
 			ret = openfile(file);
@@ -90,11 +184,19 @@ bool uksat::CnfFormula::openfile(const char* filename) {
 
 
 bool uksat::CnfFormula::openfile(std::istream& is) {
+    if (is.good() && is.peek() == uksat_BINARYMAGIC[0]) {
+        return readbinary(is);
+    }
+
 	bool ret = true;
+	bool extended = false;
 	nclauses = 0;
 	nvars = 0;
-	clauses.clear();
-    std::map<int, int> vartotals;
+	literals.clear();
+    offsets.assign(1, 0);
+    frequencies.clear();
+    varorder.clear();
+    clearcardinalities();
 
 	std::string buf;
 
@@ -132,45 +234,57 @@ bool uksat::CnfFormula::openfile(std::istream& is) {
             } else if ( nclauses > 0 && (buf[0] == '-' || isdigit(buf[0])) ) {
                 // If we already found a "header", look for clauses
                 // until all of them have been read.
-                clauses.resize(clauses.size() + 1);
+                std::size_t clausebegin = literals.size();
                 ss.str(buf);
                 
-                do {
-                    ss >> var;
-
+                // The line ends at anything that isn't a number (a clause
+                // not ended by 0 included)
+                while (ss >> var) {
                     if ((var < 0 && var < -nvars) || (var > 0 && var > nvars)) {
                         // Variable does not exist in the problem space, abort
-                        clauses.at(clauses.size() - 1).clear();
+                        literals.resize(clausebegin);
                         break;
                                 
                     } else if (var) {
-                        clauses.at(clauses.size() - 1).push_back(var);
-                        std::map<int, int>::iterator it = varfrequencies.find(var);
-                        std::map<int, int>::iterator norm_it = vartotals.find(uksat_NORMALLIT(var));
-                        
-                        if (it != varfrequencies.end()) {
-                            it->second++;
-                            
-                        } else {
-                            varfrequencies[var] = 1;
-                        }
-                        
-                        if (norm_it != vartotals.end()) {
-                            norm_it->second++;
-                            
-                        } else {
-                            vartotals[uksat_NORMALLIT(var)] = 1;
-                        }
+                        literals.push_back(var);
+                    }
+                }
+
+                // In "cnf+", the line may end as "<= k" or ">= k" instead,
+                // the latter kept as at most n - k of the negated literals
+                char op = '\0';
+                char eq = '\0';
+                long bound = -1;
+                if (extended && literals.size() > clausebegin) {
+                    ss.clear();
+                    if (ss >> op && (op == '<' || op == '>') && !(ss >> eq >> bound && eq == '=' && bound >= 0)) {
+                        literals.resize(clausebegin);
                     }
-                    
-                } while (ss.good() || var != 0);
+                }
 
-                if (clauses[clauses.size() - 1].empty()) {
-                    // We got an empty clause, abort
+                if (literals.size() == clausebegin) {
+                    // We got an empty clause (or a malformed constraint), abort
                     error = true;
-                    //clauses.resize(clauses.size() - 1);
-                    
-                } else if (clauses.size() == nclauses) {
+
+                } else if (op == '<' || op == '>') {
+                    long nlits = literals.size() - clausebegin;
+                    for (std::size_t idx = clausebegin; op == '>' && idx < literals.size(); idx++) {
+                        literals[idx] = -literals[idx];
+                    }
+
+                    cardliterals.insert(cardliterals.end(), literals.begin() + clausebegin, literals.end());
+                    cardoffsets.push_back(cardliterals.size());
+                    cardbounds.push_back(op == '<' ? std::min(bound, nlits) : nlits - std::min(bound, nlits + 1));
+                    countliterals(frequencies, &literals[clausebegin], &literals[0] + literals.size());
+                    literals.resize(clausebegin);
+
+                } else {
+                    // Grown as needed, as the problem line may be wrong
+                    countliterals(frequencies, &literals[clausebegin], &literals[0] + literals.size());
+                    offsets.push_back(literals.size());
+                }
+
+                if (!error && offsets.size() - 1 + cardbounds.size() == nclauses) {
                     // Got enough clauses, break
                     break;
                 }
@@ -184,7 +298,8 @@ bool uksat::CnfFormula::openfile(std::istream& is) {
                     ss >> tname; // The first must be ignored
                     ss >> tname;
 
-                    if (ss.good() && tname.compare("cnf") == 0) {
+                    extended = tname.compare("cnf+") == 0;
+                    if (ss.good() && (tname.compare("cnf") == 0 || extended)) {
                         ss >> nvars;
 
                         if (ss.good()) {
@@ -217,38 +332,17 @@ bool uksat::CnfFormula::openfile(std::istream& is) {
 		} while (!is.eof());
         
         // If the problem is incorrectly or partially described, abort
-        if (!nclauses || !nvars || clauses.size() != nclauses) {
+        if (!nclauses || !nvars || offsets.size() - 1 + cardbounds.size() != nclauses) {
             nclauses = 0;
             nvars = 0;
-            clauses.clear();
+            literals.clear();
+            offsets.assign(1, 0);
+            frequencies.clear();
+            clearcardinalities();
             ret = false;
         } else {
-            // Ordering variables by frequency
-            std::set<std::pair<int, int>, VarFreq_Less> ordvars;
-            
-            for (std::map<int, int>::iterator it = vartotals.begin(); it != vartotals.end(); ++it) {
-                ordvars.insert(*it);
-            }
-            
-            for (std::set<std::pair<int, int>, VarFreq_Less>::iterator it = ordvars.begin(); it != ordvars.end(); ++it) {
-                int pushvar = it->first;
-                if (frequency(-pushvar) > frequency(pushvar)) {
-                    pushvar = -pushvar;
-                }
-                
-                varorder.push_back(pushvar);
-#if 0
-                if (varorder.empty()) {
-                    varorder.push_back(pushvar);
-                    
-                } else {
-                    int lastvar = uksat_NORMALLIT(*varorder.rbegin());
-                    if (lastvar != uksat_NORMALLIT(pushvar)) {
-                        varorder.push_back(pushvar);
-                    }
-                }
-#endif
-            }
+            nclauses = offsets.size() - 1;
+            buildvarorder();
         }
         
 	} else {
@@ -259,15 +353,50 @@ bool uksat::CnfFormula::openfile(std::istream& is) {
 }
 
 
+// Orders the vars that appear in the formula by total frequency (highest
+// first, then by var), each one with its most frequent polarity (positive if
+// tied). The totals are bounded by the number of literals, so the vars are
+// counting sorted.
+void uksat::CnfFormula::buildvarorder() {
+    int maxtotal = 0;
+    for (int var = 1; var <= nvars; var++) {
+        maxtotal = std::max(maxtotal, totalfrequency(var));
+    }
+
+    // Position of the first var with each total, once the vars with higher
+    // totals are placed
+    std::vector<std::size_t> positions(maxtotal + 2, 0);
+    for (int var = 1; var <= nvars; var++) {
+        positions[totalfrequency(var)]++;
+    }
+
+    std::size_t nordered = 0;
+    for (int total = maxtotal; total > 0; total--) {
+        std::size_t count = positions[total];
+        positions[total] = nordered;
+        nordered += count;
+    }
+
+    varorder.resize(nordered);
+    for (int var = 1; var <= nvars; var++) {
+        int total = totalfrequency(var);
+        if (total) varorder[positions[total]++] = frequency(-var) > frequency(var) ? -var : var;
+    }
+}
+
+
 bool uksat::CnfFormula::savefile(const char* filename) {
 	bool ret = false;
 
 	if (filename) {
+        std::string name(filename);
+        std::string ext(uksat_BINARYEXT);
+        bool binary = name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0;
 		std::ofstream file;
-		file.open(filename);
+		file.open(filename, binary ? std::ios::out | std::ios::binary : std::ios::out);
 
 		if (file.is_open()) {
-			ret = savefile(file);
+			ret = binary ? savebinary(file) : savefile(file);
 			file.close();
 		}
 	}
@@ -279,15 +408,16 @@ bool uksat::CnfFormula::savefile(const char* filename) {
 bool uksat::CnfFormula::savefile(std::ostream& os) {
 	bool ret = false;
 
-	if (os.good() && nvars && nclauses) {
+	if (os.good() && isvalid()) {
 		ret = true;
 
-        os << "p " << "cnf" << " " << nvars << " " << nclauses << std::endl;
+        os << "p " << (cardbounds.empty() ? "cnf" : "cnf+") << " " << nvars << " " << (nclauses + cardbounds.size()) << std::endl;
 
-        for (std::vector<std::vector<int> >::iterator clause = clauses.begin(); clause != clauses.end(); clause++) {
+        for (int clauseidx = 0; clauseidx < nclauses; clauseidx++) {
+            Clause clause = (*this)[clauseidx];
             const char* sep = "";
 
-            for (std::vector<int>::iterator var = clause->begin(); var != clause->end(); var++) {
+            for (Clause::const_iterator var = clause.begin(); var != clause.end(); var++) {
                 os << sep << (*var);
                 sep = " ";
             }
@@ -295,6 +425,19 @@ bool uksat::CnfFormula::savefile(std::ostream& os) {
             os << sep << "0" << std::endl;
         }
 
+        for (std::size_t cardidx = 0; cardidx < cardbounds.size(); cardidx++) {
+            Clause card = getcardinality(cardidx);
+
+            for (Clause::const_iterator var = card.begin(); var != card.end(); var++) {
+                os << (*var) << " ";
+            }
+
+            // A negative bound can't be written, but it's as unsatisfiable
+            // as more true literals than there are
+            if (cardbounds[cardidx] < 0) os << ">= " << (card.size() + 1) << std::endl;
+            else os << "<= " << cardbounds[cardidx] << std::endl;
+        }
+
 	} else {
 		ret = false;
 	}
@@ -323,7 +466,7 @@ bool uksat::CnfFormula::savesolution(const char* filename, Solver& solver) {
 bool uksat::CnfFormula::savesolution(std::ostream& os, Solver& solver) {
 	bool ret = false;
 
-	if (os.good() && nvars && nclauses) {
+	if (os.good() && isvalid()) {
 		ret = true;
         int sat = -1;
 
@@ -0,0 +1,115 @@
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include "uksat.hpp"
+
+// Size of the blocks read from the decompressor
+#define uksat_COMPRESSED_CHUNKSIZE (1 << 20)
+
+
+// Commands decompressing each format (from STDIN), by magic number
+struct Decompressor {
+    const char* magic;
+    std::size_t size;
+    const char* command;
+};
+
+static const Decompressor decompressors[] = {
+    { "\037\213", 2, "gzip -dc" },
+    { "\3757zXZ\0", 6, "xz -dc" },
+    { "BZh", 3, "bzip2 -dc" },
+    { NULL, 0, NULL }
+};
+
+
+// Stream buffer over the output of a command, read in large blocks
+class PipeBuffer : public std::streambuf {
+public:
+    explicit PipeBuffer(FILE* _file) : file(_file), buffer(uksat_COMPRESSED_CHUNKSIZE) {}
+
+protected:
+    int_type underflow() {
+        std::size_t nread = std::fread(&buffer[0], 1, buffer.size(), file);
+        if (!nread) return traits_type::eof();
+        setg(&buffer[0], &buffer[0], &buffer[0] + nread);
+        return traits_type::to_int_type(buffer[0]);
+    }
+
+private:
+    FILE* file;
+    std::vector<char> buffer;
+};
+
+
+static const char* finddecompressor(const char* filename) {
+    const char* command = NULL;
+    char magic[8];
+    std::size_t nread = 0;
+    FILE* file = std::fopen(filename, "rb");
+
+    if (file) {
+        nread = std::fread(magic, 1, sizeof(magic), file);
+        std::fclose(file);
+    }
+
+    for (const Decompressor* it = decompressors; it->magic && !command; ++it) {
+        if (nread >= it->size && std::memcmp(magic, it->magic, it->size) == 0) command = it->command;
+    }
+
+    return command;
+}
+
+
+// Quotes a file name for the shell
+static std::string shellquote(const char* filename) {
+    std::string quoted("'");
+    for (const char* it = filename; *it; ++it) {
+        if (*it == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += *it;
+        }
+    }
+    return quoted + "'";
+}
+
+
+// Reads a formula compressed with gzip, xz or bzip2 through their own
+// command, which decompresses the next blocks while the current ones are
+// parsed. Returns 1 if it was loaded, -1 if it's compressed but couldn't be
+// loaded, and 0 if it isn't compressed.
+int uksat::CnfFormula::opencompressed(const char* filename) {
+    int ret = 0;
+    const char* command = finddecompressor(filename);
+
+    if (command) {
+        // Run in place of the shell, so that its own status is returned
+        std::string cmdline = "exec " + std::string(command) + " < " + shellquote(filename);
+        FILE* pipe = popen(cmdline.c_str(), "r");
+        ret = -1;
+
+        if (pipe) {
+            PipeBuffer buffer(pipe);
+            std::istream is(&buffer);
+
+            if (openfile(is)) ret = 1;
+
+            // The parser stops after the last clause, so the decompressor may
+            // die of a broken pipe; any other failure (corrupt data) fails
+            // the load
+            int status = pclose(pipe);
+            bool failed = status == -1 || (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+                || (WIFSIGNALED(status) && WTERMSIG(status) != SIGPIPE);
+            if (failed) {
+                nvars = nclauses = 0;
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,456 @@
+
+#include <algorithm>
+#include <iostream>
+#include "uksat.hpp"
+
+// Literals (key ints) kept in the component cache before it's flushed
+#define uksat_COUNT_DEFCACHE (1 << 25)
+
+// How many components are counted between two time checks
+#define uksat_COUNT_TIMESTEP 256
+
+// Bytes the cache takes per key int, roughly (with the hashes and the counts
+// of the small components), under memory pressure
+#define uksat_COUNT_ENTRYBYTES 16
+
+// FNV-1a, over the ints of the component keys
+#define uksat_COUNT_HASHBASIS UINT64_C(14695981039346656037)
+#define uksat_COUNT_HASHPRIME UINT64_C(1099511628211)
+
+// Decimal digits per division in ModelCount::str
+#define uksat_COUNT_DECBASE   1000000000UL
+#define uksat_COUNT_DECDIGITS 9
+
+
+static uint64_t hashkey(const std::vector<int>& key) {
+    uint64_t hash = uksat_COUNT_HASHBASIS;
+    for (std::vector<int>::const_iterator it = key.begin(); it != key.end(); ++it) {
+        hash = (hash ^ static_cast<uint32_t>(*it)) * uksat_COUNT_HASHPRIME;
+    }
+    return hash;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Model counts ]
+ */
+
+
+uksat::ModelCount::ModelCount(uint64_t value) {
+    while (value) {
+        limbs.push_back(static_cast<uint32_t>(value));
+        value >>= 32;
+    }
+}
+
+
+bool uksat::ModelCount::iszero() const {
+    return limbs.empty();
+}
+
+
+void uksat::ModelCount::add(const ModelCount& other) {
+    uint64_t carry = 0;
+    if (limbs.size() < other.limbs.size()) limbs.resize(other.limbs.size(), 0);
+
+    for (std::size_t idx = 0; idx < limbs.size(); idx++) {
+        carry += limbs[idx];
+        if (idx < other.limbs.size()) carry += other.limbs[idx];
+        else if (!carry) break;
+        limbs[idx] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    if (carry) limbs.push_back(static_cast<uint32_t>(carry));
+}
+
+
+void uksat::ModelCount::multiply(const ModelCount& other) {
+    if (iszero() || other.iszero()) {
+        limbs.clear();
+
+    } else {
+        std::vector<uint32_t> product(limbs.size() + other.limbs.size(), 0);
+
+        for (std::size_t idx = 0; idx < limbs.size(); idx++) {
+            uint64_t carry = 0;
+            for (std::size_t jdx = 0; jdx < other.limbs.size(); jdx++) {
+                carry += static_cast<uint64_t>(limbs[idx]) * other.limbs[jdx] + product[idx + jdx];
+                product[idx + jdx] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            product[idx + other.limbs.size()] = static_cast<uint32_t>(carry);
+        }
+
+        while (!product.empty() && !product.back()) product.pop_back();
+        limbs.swap(product);
+    }
+}
+
+
+// Multiplies by 2^bits
+void uksat::ModelCount::shift(std::size_t bits) {
+    if (iszero()) return;
+
+    std::size_t nbits = bits % 32;
+    limbs.insert(limbs.begin(), bits / 32, 0);
+
+    if (nbits) {
+        uint32_t carry = 0;
+        for (std::size_t idx = bits / 32; idx < limbs.size(); idx++) {
+            uint32_t limb = limbs[idx];
+            limbs[idx] = (limb << nbits) | carry;
+            carry = limb >> (32 - nbits);
+        }
+        if (carry) limbs.push_back(carry);
+    }
+}
+
+
+std::string uksat::ModelCount::str() const {
+    std::vector<uint32_t> quotient(limbs);
+    std::vector<uint32_t> chunks;
+    std::ostringstream ss;
+
+    // Divided by 10^9 until nothing is left, the lowest digits first
+    while (!quotient.empty()) {
+        uint64_t remainder = 0;
+        for (std::size_t idx = quotient.size(); idx-- > 0; ) {
+            remainder = (remainder << 32) | quotient[idx];
+            quotient[idx] = static_cast<uint32_t>(remainder / uksat_COUNT_DECBASE);
+            remainder %= uksat_COUNT_DECBASE;
+        }
+        while (!quotient.empty() && !quotient.back()) quotient.pop_back();
+        chunks.push_back(static_cast<uint32_t>(remainder));
+    }
+
+    if (chunks.empty()) {
+        ss << 0;
+    } else {
+        ss << chunks.back();
+        for (std::size_t idx = chunks.size() - 1; idx-- > 0; ) {
+            ss.width(uksat_COUNT_DECDIGITS);
+            ss.fill('0');
+            ss << chunks[idx];
+        }
+    }
+
+    return ss.str();
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Counting solver ]
+ */
+
+
+uksat::CountingSolver::CountingSolver(CnfFormula& _formula)
+: PropagatingSolver(_formula)
+, maxcache(uksat_COUNT_DEFCACHE)
+, ndecisions(0)
+, ncomponents(0)
+, ncachehits(0)
+, ncacheflushes(0)
+{
+
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters/Setters ]
+ */
+
+
+const uksat::ModelCount& uksat::CountingSolver::getcount() const {
+    return count;
+}
+
+
+std::size_t uksat::CountingSolver::getmaxcache() const {
+    return maxcache;
+}
+
+
+void uksat::CountingSolver::setmaxcache(std::size_t nlits) {
+    maxcache = nlits;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Counting ]
+ */
+
+
+// The count is only valid if the solver wasn't stopped (by the time or the
+// memory limit): 0 when conflicting, and the number of models (over every
+// var) when satisfied. Formulas with cardinality constraints are not counted
+// (left undefined).
+bool uksat::CountingSolver::query() {
+    start();
+
+    if (isstarted() && formula.getncardinalities()) {
+        finish(0);
+
+    } else if (isstarted()) {
+        bool ok = true;
+        load();
+
+        for (std::size_t clauseidx = 0; ok && clauseidx < static_cast<std::size_t>(formula.getnclauses()); clauseidx++) {
+            CnfFormula::Clause clause = formula[clauseidx];
+            if (clause.size() == 1) ok = assign(*clause.begin());
+        }
+        ok = ok && propagate();
+
+        if (ok) {
+            std::vector<int> vars;
+            std::vector<std::size_t> clauseidxs;
+
+            for (int var = 1; var <= formula.getnvars(); var++) vars.push_back(var);
+            for (std::size_t clauseidx = 0; clauseidx < static_cast<std::size_t>(formula.getnclauses()); clauseidx++) {
+                if (!issatclause(clauseidx)) clauseidxs.push_back(clauseidx);
+            }
+            countresidual(vars, clauseidxs, count);
+        }
+
+        if (isstopped()) finish(0);
+        else finish(count.iszero() ? -1 : 1);
+    }
+
+    return issatisfied();
+}
+
+
+void uksat::CountingSolver::printstats(std::ostream& os) {
+    Solver::printstats(os);
+    os << "\tdecisions: " << ndecisions << std::endl;
+    os << "\tcomponents: " << ncomponents << std::endl;
+    os << "\tcachehits: " << ncachehits << std::endl;
+    os << "\tcacheentries: " << cachedcounts.size() << std::endl;
+    os << "\tcacheflushes: " << ncacheflushes << std::endl;
+}
+
+
+// The cache as the key ints and the tree nodes of their hashes (each with
+// the color and three links), besides the counts
+std::size_t uksat::CountingSolver::getmemory() const {
+    return PropagatingSolver::getmemory() + memoryof(roots) + memoryof(scores) + memoryof(cachedkeys)
+        + memoryof(cachedoffsets) + memoryof(cachedcounts)
+        + cachedhashes.size() * (sizeof(std::pair<uint64_t, std::size_t>) + 4 * sizeof(void*));
+}
+
+
+void uksat::CountingSolver::clear() {
+    PropagatingSolver::clear();
+    count = ModelCount();
+    roots.clear();
+    scores.clear();
+    cachedhashes.clear();
+    cachedkeys.clear();
+    cachedoffsets.clear();
+    cachedcounts.clear();
+    ndecisions = ncomponents = ncachehits = ncacheflushes = 0;
+}
+
+
+void uksat::CountingSolver::load() {
+    std::size_t nvars = formula.getnvars();
+
+    // Unit clauses are assigned before counting
+    loadwatches();
+    count = ModelCount();
+    roots.assign(nvars + 1, 0);
+    scores.assign(nvars + 1, 0);
+    cachedhashes.clear();
+    cachedkeys.clear();
+    cachedoffsets.assign(1, 0);
+    cachedcounts.clear();
+}
+
+
+bool uksat::CountingSolver::issatclause(std::size_t clauseidx) const {
+    CnfFormula::Clause clause = formula[clauseidx];
+    for (CnfFormula::Clause::const_iterator it = clause.begin(); it != clause.end(); ++it) {
+        if (value(*it) > 0) return true;
+    }
+    return false;
+}
+
+
+int uksat::CountingSolver::findroot(int var) {
+    while (roots[var] != var) {
+        roots[var] = roots[roots[var]];
+        var = roots[var];
+    }
+    return var;
+}
+
+
+// Counts the models of the unsatisfied clauses `clauseidxs` over `vars` (all
+// of them sorted): the product of the counts of their components (vars joined
+// by the clauses they share), doubled for every var left in no clause
+void uksat::CountingSolver::countresidual(const std::vector<int>& vars, const std::vector<std::size_t>& clauseidxs, ModelCount& residualcount) {
+    std::vector<std::vector<int> > compvars;
+    std::vector<std::vector<std::size_t> > compclauseidxs;
+    std::size_t nfree = 0;
+
+    // Roots are 0 for the vars in no clause, and scores are the component of
+    // each root (plus one)
+    for (std::vector<int>::const_iterator it = vars.begin(); it != vars.end(); ++it) {
+        roots[*it] = scores[*it] = 0;
+    }
+    for (std::vector<std::size_t>::const_iterator it = clauseidxs.begin(); it != clauseidxs.end(); ++it) {
+        CnfFormula::Clause clause = formula[*it];
+        int firstroot = 0;
+
+        for (CnfFormula::Clause::const_iterator iv = clause.begin(); iv != clause.end(); ++iv) {
+            int var = uksat_NORMALLIT(*iv);
+            if (values[var]) continue;
+            if (!roots[var]) roots[var] = var;
+
+            int root = findroot(var);
+            if (!firstroot) firstroot = root;
+            else if (root != firstroot) roots[root] = firstroot;
+        }
+    }
+
+    for (std::vector<int>::const_iterator it = vars.begin(); it != vars.end(); ++it) {
+        int var = *it;
+        if (values[var]) continue;
+
+        if (!roots[var]) {
+            nfree++;
+        } else {
+            int root = findroot(var);
+            if (!scores[root]) {
+                scores[root] = compvars.size() + 1;
+                compvars.push_back(std::vector<int>());
+            }
+            compvars[scores[root] - 1].push_back(var);
+        }
+    }
+    compclauseidxs.resize(compvars.size());
+    for (std::vector<std::size_t>::const_iterator it = clauseidxs.begin(); it != clauseidxs.end(); ++it) {
+        CnfFormula::Clause clause = formula[*it];
+        CnfFormula::Clause::const_iterator iv = clause.begin();
+        while (values[uksat_NORMALLIT(*iv)]) ++iv;
+        compclauseidxs[scores[findroot(uksat_NORMALLIT(*iv))] - 1].push_back(*it);
+    }
+    for (std::vector<int>::const_iterator it = vars.begin(); it != vars.end(); ++it) {
+        scores[*it] = 0;
+    }
+
+    residualcount = ModelCount(1);
+    for (std::size_t idx = 0; idx < compvars.size() && !residualcount.iszero() && !isstopped(); idx++) {
+        ModelCount compcount;
+        countcomponent(compvars[idx], compclauseidxs[idx], compcount);
+        residualcount.multiply(compcount);
+    }
+    residualcount.shift(nfree);
+}
+
+
+// Counts a component by branching on its most frequent var, unless it's
+// cached. The vars determine which literals of its clauses are left, so both
+// (sorted) identify the residual clauses.
+void uksat::CountingSolver::countcomponent(const std::vector<int>& vars, const std::vector<std::size_t>& clauseidxs, ModelCount& compcount) {
+    std::vector<int> key(vars);
+    key.push_back(0);
+    key.insert(key.end(), clauseidxs.begin(), clauseidxs.end());
+
+    ncomponents++;
+    if (!(ncomponents % uksat_COUNT_TIMESTEP)) intime();
+    if (isstopped()) return;
+
+    if (lookup(key, compcount)) {
+        ncachehits++;
+        return;
+    }
+
+    int var = choosebranchvar(vars, clauseidxs);
+    compcount = ModelCount();
+
+    for (int sign = 1; sign >= -1 && !isstopped(); sign -= 2) {
+        std::size_t trailsize = trail.size();
+        ndecisions++;
+
+        if (assign(sign * var) && propagate()) {
+            std::vector<std::size_t> residualidxs;
+            ModelCount branchcount;
+
+            for (std::vector<std::size_t>::const_iterator it = clauseidxs.begin(); it != clauseidxs.end(); ++it) {
+                if (!issatclause(*it)) residualidxs.push_back(*it);
+            }
+            countresidual(vars, residualidxs, branchcount);
+            compcount.add(branchcount);
+        }
+
+        undo(trailsize);
+    }
+
+    if (!isstopped()) store(key, compcount);
+}
+
+
+int uksat::CountingSolver::choosebranchvar(const std::vector<int>& vars, const std::vector<std::size_t>& clauseidxs) {
+    int bestvar = vars.front();
+
+    for (std::vector<std::size_t>::const_iterator it = clauseidxs.begin(); it != clauseidxs.end(); ++it) {
+        CnfFormula::Clause clause = formula[*it];
+        for (CnfFormula::Clause::const_iterator iv = clause.begin(); iv != clause.end(); ++iv) {
+            int var = uksat_NORMALLIT(*iv);
+            if (!values[var]) scores[var]++;
+        }
+    }
+    for (std::vector<int>::const_iterator it = vars.begin(); it != vars.end(); ++it) {
+        if (scores[*it] > scores[bestvar]) bestvar = *it;
+    }
+    for (std::vector<int>::const_iterator it = vars.begin(); it != vars.end(); ++it) {
+        scores[*it] = 0;
+    }
+
+    return bestvar;
+}
+
+
+bool uksat::CountingSolver::lookup(const std::vector<int>& key, ModelCount& cachedcount) {
+    typedef std::multimap<uint64_t, std::size_t>::const_iterator HashIterator;
+    std::pair<HashIterator, HashIterator> range = cachedhashes.equal_range(hashkey(key));
+
+    for (HashIterator it = range.first; it != range.second; ++it) {
+        std::size_t begin = cachedoffsets[it->second];
+        std::size_t end = cachedoffsets[it->second + 1];
+
+        if (end - begin == key.size() && std::equal(key.begin(), key.end(), cachedkeys.begin() + begin)) {
+            cachedcount = cachedcounts[it->second];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+// The whole cache is flushed (and its memory given back) once it would hold
+// more than `maxcache` ints. Past half the memory budget, it's held to a
+// share of the memory left as well, down to nothing at the budget.
+void uksat::CountingSolver::store(const std::vector<int>& key, const ModelCount& compcount) {
+    std::size_t limit = maxcache;
+
+    if (maxmemory && memory > maxmemory / 2) {
+        std::size_t left = memory < maxmemory ? maxmemory - memory : 0;
+        limit = std::min(limit, left / uksat_COUNT_ENTRYBYTES);
+    }
+    if (key.size() > limit) return;
+
+    if (cachedkeys.size() + key.size() > limit) {
+        std::multimap<uint64_t, std::size_t>().swap(cachedhashes);
+        std::vector<int>().swap(cachedkeys);
+        cachedoffsets.assign(1, 0);
+        std::vector<ModelCount>().swap(cachedcounts);
+        ncacheflushes++;
+    }
+
+    cachedhashes.insert(std::make_pair(hashkey(key), cachedcounts.size()));
+    cachedkeys.insert(cachedkeys.end(), key.begin(), key.end());
+    cachedoffsets.push_back(cachedkeys.size());
+    cachedcounts.push_back(compcount);
+}
@@ -0,0 +1,626 @@
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include "uksat.hpp"
+
+// FNV-1a, over the sorted literals of a clause
+#define uksat_DRAT_HASHBASIS UINT64_C(14695981039346656037)
+#define uksat_DRAT_HASHPRIME UINT64_C(1099511628211)
+
+
+static uint64_t clausehash(const std::vector<int>& sorted) {
+    uint64_t hash = uksat_DRAT_HASHBASIS;
+    for (std::vector<int>::const_iterator it = sorted.begin(); it != sorted.end(); ++it) {
+        hash ^= static_cast<uint32_t>(*it);
+        hash *= uksat_DRAT_HASHPRIME;
+    }
+    return hash;
+}
+
+
+uksat::ProofChecker::ProofChecker(CnfFormula& _formula)
+: formula(_formula)
+{
+    clear();
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters/Setters ]
+ */
+
+
+int uksat::ProofChecker::getresult() const {
+    return result;
+}
+
+
+std::size_t uksat::ProofChecker::getnlemmas() const {
+    return nlemmas;
+}
+
+
+std::size_t uksat::ProofChecker::getndeleted() const {
+    return ndeleted;
+}
+
+
+std::size_t uksat::ProofChecker::getnignored() const {
+    return nignored;
+}
+
+
+std::size_t uksat::ProofChecker::getnchecked() const {
+    return nchecked;
+}
+
+
+std::size_t uksat::ProofChecker::getncore() const {
+    return ncore;
+}
+
+
+std::size_t uksat::ProofChecker::getnrat() const {
+    return nrat;
+}
+
+
+long uksat::ProofChecker::getfailedlemma() const {
+    return failedlemma;
+}
+
+
+const std::vector<int>& uksat::ProofChecker::getfailedlits() const {
+    return failedlits;
+}
+
+
+double uksat::ProofChecker::getelapsedtime() const {
+    return static_cast<double>(clockend - clockbegin) / static_cast<double>(CLOCKS_PER_SEC);
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Reading ]
+ */
+
+
+bool uksat::ProofChecker::openproof(const char* filename) {
+    bool ret = false;
+
+    if (filename) {
+        std::ifstream file;
+        file.open(filename, std::ios::in | std::ios::binary);
+
+        if (file.is_open()) {
+            ret = openproof(file);
+            file.close();
+        }
+    }
+
+    return ret;
+}
+
+
+// Loads the formula, then reads the proof, keeping track of the clauses
+// active at each step. Anything after the first empty clause is ignored.
+bool uksat::ProofChecker::openproof(std::istream& is) {
+    std::string data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    std::vector<int> clause;
+    bool ok = formula.isvalid();
+
+    clear();
+    if (!ok) return false;
+
+    for (int clauseidx = 0; clauseidx < formula.getnclauses(); clauseidx++) {
+        CnfFormula::Clause fclause = formula[clauseidx];
+        clause.assign(fclause.begin(), fclause.end());
+        addstep(false, clause);
+    }
+    steps.clear();
+    nlemmas = 0;
+    nformula = offsets.size() - 1;
+
+    // Binary proofs start with an 'a' or a 'd' byte; text deletions
+    // always have a space after the 'd'
+    std::size_t pos = 0;
+    std::size_t size = data.size();
+    bool binary = size && (data[0] == 'a' || (data[0] == 'd' && size > 1 && data[1] != ' '));
+
+    while (ok && pos < size && emptyidx < 0) {
+        bool deletion = false;
+        clause.clear();
+
+        if (binary) {
+            char type = data[pos++];
+            if (type != 'a' && type != 'd') {
+                ok = false;
+                break;
+            }
+            deletion = type == 'd';
+
+            while (true) {
+                uint32_t code = 0;
+                int shift = 0;
+                unsigned char byte;
+                do {
+                    if (pos >= size || shift > 28) return false;
+                    byte = static_cast<unsigned char>(data[pos++]);
+                    code |= static_cast<uint32_t>(byte & 127) << shift;
+                    shift += 7;
+                } while (byte & 128);
+                if (!code) break;
+                int var = static_cast<int>(code >> 1);
+                clause.push_back(code & 1 ? -var : var);
+            }
+
+        } else {
+            while (pos < size && std::isspace(data[pos])) pos++;
+            if (pos == size) break;
+            if (data[pos] == 'c') {
+                while (pos < size && data[pos] != '\n') pos++;
+                continue;
+            }
+            if (data[pos] == 'd') {
+                deletion = true;
+                pos++;
+            }
+
+            while (true) {
+                bool negative = false;
+                int lit = 0;
+                while (pos < size && std::isspace(data[pos])) pos++;
+                if (pos < size && data[pos] == '-') {
+                    negative = true;
+                    pos++;
+                }
+                if (pos == size || !std::isdigit(data[pos])) return false;
+                while (pos < size && std::isdigit(data[pos])) lit = lit * 10 + (data[pos++] - '0');
+                if (!lit) break;
+                clause.push_back(negative ? -lit : lit);
+            }
+        }
+
+        addstep(deletion, clause);
+    }
+
+    // With no empty clause, the proof must refute the formula at its end
+    if (ok && emptyidx < 0) {
+        emptyidx = addclause(NULL, NULL, 0);
+    }
+
+    return ok;
+}
+
+
+void uksat::ProofChecker::clear() {
+    literals.clear();
+    offsets.assign(1, 0);
+    pivots.clear();
+    active.clear();
+    core.clear();
+    units.clear();
+    nformula = 0;
+    steps.clear();
+    emptyidx = -1;
+    hashes.clear();
+    maxvar = formula.getnvars();
+    values.clear();
+    reasons.clear();
+    seen.clear();
+    trail.clear();
+    qhead = 0;
+    watches.clear();
+    hints.clear();
+    hintranges.clear();
+    lemmahints.clear();
+    result = 0;
+    nlemmas = ndeleted = nignored = nchecked = ncore = nrat = 0;
+    failedlemma = -1;
+    failedlits.clear();
+    clockbegin = clockend = 0;
+}
+
+
+// Stores a clause without duplicated literals, inactive
+std::size_t uksat::ProofChecker::addclause(const int* begin, const int* end, int pivot) {
+    std::size_t clausebegin = literals.size();
+
+    for (const int* it = begin; it != end; ++it) {
+        if (std::find(literals.begin() + clausebegin, literals.end(), *it) == literals.end()) {
+            literals.push_back(*it);
+            maxvar = std::max(maxvar, static_cast<int>(uksat_NORMALLIT(*it)));
+        }
+    }
+
+    offsets.push_back(literals.size());
+    pivots.push_back(pivot);
+    active.push_back(false);
+    core.push_back(false);
+    return offsets.size() - 2;
+}
+
+
+// Applies an addition or a deletion to the set of active clauses. Deletions
+// of unit clauses are ignored, as most solvers expect them to be.
+void uksat::ProofChecker::addstep(bool deletion, const std::vector<int>& clause) {
+    std::vector<int> sorted(clause);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    if (deletion) {
+        long clauseidx = sorted.size() > 1 ? findclause(sorted) : -1;
+        if (clauseidx < 0) {
+            nignored++;
+
+        } else {
+            active[clauseidx] = false;
+            steps.push_back(-(clauseidx + 1));
+            ndeleted++;
+        }
+
+    } else {
+        const int* begin = clause.empty() ? NULL : &clause[0];
+        std::size_t clauseidx = addclause(begin, begin + clause.size(), clause.empty() ? 0 : clause[0]);
+        active[clauseidx] = true;
+        hashes.insert(std::pair<uint64_t, std::size_t>(clausehash(sorted), clauseidx));
+        steps.push_back(clauseidx);
+        nlemmas++;
+        if (sorted.empty()) emptyidx = clauseidx;
+    }
+}
+
+
+// Finds (and forgets) an active clause with the given sorted literals
+long uksat::ProofChecker::findclause(const std::vector<int>& sorted) {
+    typedef std::multimap<uint64_t, std::size_t>::iterator HashIterator;
+    std::pair<HashIterator, HashIterator> range = hashes.equal_range(clausehash(sorted));
+    std::vector<int> other;
+
+    for (HashIterator it = range.first; it != range.second; ++it) {
+        other.assign(literals.begin() + offsets[it->second], literals.begin() + offsets[it->second + 1]);
+        std::sort(other.begin(), other.end());
+
+        if (other == sorted) {
+            long clauseidx = it->second;
+            hashes.erase(it);
+            return clauseidx;
+        }
+    }
+
+    return -1;
+}
+
+
+void uksat::ProofChecker::activate(std::size_t clauseidx) {
+    std::size_t size = offsets[clauseidx + 1] - offsets[clauseidx];
+    const int* lits = &literals[offsets[clauseidx]];
+    active[clauseidx] = true;
+
+    if (size == 1) {
+        units.push_back(clauseidx);
+    } else if (size > 1) {
+        watches[uksat_LITIDX(lits[0])].push_back(clauseidx);
+        watches[uksat_LITIDX(lits[1])].push_back(clauseidx);
+    }
+}
+
+
+void uksat::ProofChecker::deactivate(std::size_t clauseidx) {
+    std::size_t size = offsets[clauseidx + 1] - offsets[clauseidx];
+    const int* lits = &literals[offsets[clauseidx]];
+    active[clauseidx] = false;
+
+    if (size == 1) {
+        units.erase(std::find(units.begin(), units.end(), clauseidx));
+
+    } else if (size > 1) {
+        // A clause is only in the watch lists of its first two literals
+        for (int idx = 0; idx < 2; idx++) {
+            std::vector<std::size_t>& watchlist = watches[uksat_LITIDX(lits[idx])];
+            std::vector<std::size_t>::iterator it = std::find(watchlist.begin(), watchlist.end(), clauseidx);
+            *it = watchlist.back();
+            watchlist.pop_back();
+        }
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Checking ]
+ */
+
+
+// Starting from the clauses active at the empty clause, undoes the proof
+// step by step. Each lemma is removed before being checked, and only those
+// used by a later check (the core) are checked at all.
+int uksat::ProofChecker::check() {
+    std::size_t nclauses = offsets.size() - 1;
+    clockbegin = std::clock();
+    result = -1;
+    ncore = nchecked = nrat = 0;
+    hints.clear();
+    hintranges.assign(nclauses, std::pair<std::size_t, std::size_t>(0, 0));
+
+    values.assign(maxvar + 1, 0);
+    reasons.assign(maxvar + 1, -1);
+    seen.assign(maxvar + 1, false);
+    watches.assign(2 * (maxvar + 1), std::vector<std::size_t>());
+    units.clear();
+    trail.clear();
+    qhead = 0;
+
+    if (emptyidx >= 0) {
+        for (std::size_t clauseidx = 0; clauseidx < nclauses; clauseidx++) {
+            if (active[clauseidx]) activate(clauseidx);
+        }
+        core[emptyidx] = true;
+        result = 1;
+    }
+
+    std::size_t step = steps.size();
+    if (static_cast<std::size_t>(emptyidx) >= nformula + nlemmas) step++;
+
+    while (result > 0 && step--) {
+        long clauseidx = step < steps.size() ? steps[step] : emptyidx;
+
+        if (clauseidx < 0) {
+            activate(-clauseidx - 1);
+            continue;
+        }
+
+        if (clauseidx != emptyidx) deactivate(clauseidx);
+        if (!core[clauseidx]) continue;
+
+        const int* begin = &literals[0] + offsets[clauseidx];
+        const int* end = &literals[0] + offsets[clauseidx + 1];
+        lemmahints.clear();
+        ncore++;
+
+        if (rup(begin, end, lemmahints) || rat(clauseidx, lemmahints)) {
+            hintranges[clauseidx] = std::pair<std::size_t, std::size_t>(hints.size(), hints.size() + lemmahints.size());
+            hints.insert(hints.end(), lemmahints.begin(), lemmahints.end());
+
+        } else {
+            result = -1;
+            failedlemma = clauseidx - nformula + 1;
+            failedlits.assign(begin, end);
+            std::vector<int>::iterator pivot = std::find(failedlits.begin(), failedlits.end(), pivots[clauseidx]);
+            if (pivot != failedlits.end()) std::iter_swap(failedlits.begin(), pivot);
+        }
+    }
+
+    clockend = std::clock();
+    return result;
+}
+
+
+int uksat::ProofChecker::value(int lit) const {
+    int val = values[uksat_NORMALLIT(lit)];
+    return lit < 0 ? -val : val;
+}
+
+
+bool uksat::ProofChecker::assign(int lit, long reason) {
+    std::size_t var = uksat_NORMALLIT(lit);
+    values[var] = lit < 0 ? -1 : 1;
+    reasons[var] = reason;
+    trail.push_back(lit);
+    return true;
+}
+
+
+void uksat::ProofChecker::undo() {
+    for (std::vector<int>::const_iterator it = trail.begin(); it != trail.end(); ++it) {
+        std::size_t var = uksat_NORMALLIT(*it);
+        values[var] = 0;
+        reasons[var] = -1;
+    }
+    trail.clear();
+    qhead = 0;
+}
+
+
+// Reverse unit propagation: checks whether assuming the negation of the
+// clause leads to a conflict. The clauses involved are marked as core and
+// appended to `lemmahints`, in the order they became unit.
+bool uksat::ProofChecker::rup(const int* begin, const int* end, std::vector<long>& lemmahints) {
+    bool conflicting = false;
+    long conflict = -1;
+    nchecked++;
+
+    for (const int* it = begin; it != end && !conflicting; ++it) {
+        int truth = value(-(*it));
+        if (truth < 0) conflicting = true;  // Tautologies hold trivially
+        else if (!truth) assign(-(*it), -1);
+    }
+
+    for (std::vector<std::size_t>::const_iterator it = units.begin(); it != units.end() && !conflicting; ++it) {
+        int lit = literals[offsets[*it]];
+        int truth = value(lit);
+        if (truth < 0) conflict = *it;
+        else if (!truth) assign(lit, *it);
+        conflicting = conflict >= 0;
+    }
+
+    if (!conflicting) {
+        conflict = propagate();
+        conflicting = conflict >= 0;
+    }
+
+    if (conflict >= 0) analyze(conflict, lemmahints);
+    undo();
+    return conflicting;
+}
+
+
+// Resolution asymmetric tautology on the first literal of the lemma: every
+// resolvent with an active clause containing its negation must be RUP.
+bool uksat::ProofChecker::rat(std::size_t clauseidx, std::vector<long>& lemmahints) {
+    int pivot = pivots[clauseidx];
+    std::vector<int> resolvent;
+    lemmahints.clear();
+    if (!pivot) return false;
+    nrat++;
+
+    for (std::size_t otheridx = 0; otheridx < clauseidx; otheridx++) {
+        if (!active[otheridx]) continue;
+        const int* otherbegin = &literals[0] + offsets[otheridx];
+        const int* otherend = &literals[0] + offsets[otheridx + 1];
+        if (std::find(otherbegin, otherend, -pivot) == otherend) continue;
+
+        resolvent.assign(literals.begin() + offsets[clauseidx], literals.begin() + offsets[clauseidx + 1]);
+        for (const int* it = otherbegin; it != otherend; ++it) {
+            if (*it != -pivot) resolvent.push_back(*it);
+        }
+
+        core[otheridx] = true;
+        lemmahints.push_back(-static_cast<long>(otheridx + 1));
+        if (!rup(&resolvent[0], &resolvent[0] + resolvent.size(), lemmahints)) return false;
+    }
+
+    return true;
+}
+
+
+// Propagates the trail through the watched literals. Returns the index of a
+// falsified clause, or -1.
+long uksat::ProofChecker::propagate() {
+    while (qhead < trail.size()) {
+        int falselit = -trail[qhead++];
+        std::vector<std::size_t>& watchlist = watches[uksat_LITIDX(falselit)];
+        std::size_t nwatches = watchlist.size();
+        std::size_t idx = 0;
+        std::size_t kept = 0;
+        long conflict = -1;
+
+        while (idx < nwatches) {
+            std::size_t clauseidx = watchlist[idx++];
+            int* lits = &literals[offsets[clauseidx]];
+            std::size_t size = offsets[clauseidx + 1] - offsets[clauseidx];
+            bool moved = false;
+
+            if (lits[0] == falselit) std::swap(lits[0], lits[1]);
+            if (value(lits[0]) > 0) {
+                watchlist[kept++] = clauseidx;
+                continue;
+            }
+
+            for (std::size_t pos = 2; pos < size && !moved; pos++) {
+                if (value(lits[pos]) >= 0) {
+                    std::swap(lits[1], lits[pos]);
+                    watches[uksat_LITIDX(lits[1])].push_back(clauseidx);
+                    moved = true;
+                }
+            }
+            if (moved) continue;
+
+            watchlist[kept++] = clauseidx;
+            if (value(lits[0]) < 0) {
+                conflict = clauseidx;
+                while (idx < nwatches) watchlist[kept++] = watchlist[idx++];
+            } else {
+                assign(lits[0], clauseidx);
+            }
+        }
+
+        watchlist.resize(kept);
+        if (conflict >= 0) return conflict;
+    }
+
+    return -1;
+}
+
+
+// Walks the trail back from the conflict, collecting the reasons involved
+void uksat::ProofChecker::analyze(long conflict, std::vector<long>& lemmahints) {
+    std::size_t first = lemmahints.size();
+    const int* begin = &literals[0] + offsets[conflict];
+    const int* end = &literals[0] + offsets[conflict + 1];
+
+    core[conflict] = true;
+    for (const int* it = begin; it != end; ++it) seen[uksat_NORMALLIT(*it)] = true;
+
+    for (std::size_t idx = trail.size(); idx--; ) {
+        std::size_t var = uksat_NORMALLIT(trail[idx]);
+        long reason = reasons[var];
+        if (!seen[var] || reason < 0) continue;
+
+        core[reason] = true;
+        lemmahints.push_back(reason + 1);
+        for (std::size_t pos = offsets[reason]; pos < offsets[reason + 1]; pos++) {
+            seen[uksat_NORMALLIT(literals[pos])] = true;
+        }
+    }
+
+    std::reverse(lemmahints.begin() + first, lemmahints.end());
+    lemmahints.push_back(conflict + 1);
+
+    for (std::vector<int>::const_iterator it = trail.begin(); it != trail.end(); ++it) seen[uksat_NORMALLIT(*it)] = false;
+    for (const int* it = begin; it != end; ++it) seen[uksat_NORMALLIT(*it)] = false;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Output ]
+ */
+
+
+bool uksat::ProofChecker::savelrat(const char* filename) {
+    bool ret = false;
+
+    if (filename) {
+        std::ofstream file;
+        file.open(filename);
+
+        if (file.is_open()) {
+            ret = savelrat(file);
+            file.close();
+        }
+    }
+
+    return ret;
+}
+
+
+// Writes the core lemmas, each with the clauses that make it RUP (or, for RAT
+// lemmas, each candidate negated, followed by the resolvent's hints). Clause
+// ids are the clause indexes plus one, formula clauses first.
+bool uksat::ProofChecker::savelrat(std::ostream& os) {
+    long lastid = nformula;
+    if (result <= 0 || !os.good()) return false;
+
+    for (std::size_t step = 0; step <= steps.size(); step++) {
+        long clauseidx = step < steps.size() ? steps[step] : emptyidx;
+
+        if (clauseidx < 0) {
+            std::size_t deletedidx = -clauseidx - 1;
+            if (deletedidx < nformula || core[deletedidx]) {
+                os << lastid << " d " << (deletedidx + 1) << " 0\n";
+            }
+
+        } else if (core[clauseidx]) {
+            int pivot = pivots[clauseidx];
+            lastid = clauseidx + 1;
+            os << lastid;
+            if (pivot) os << " " << pivot;
+            for (std::size_t pos = offsets[clauseidx]; pos < offsets[clauseidx + 1]; pos++) {
+                if (literals[pos] != pivot) os << " " << literals[pos];
+            }
+            os << " 0";
+            for (std::size_t pos = hintranges[clauseidx].first; pos < hintranges[clauseidx].second; pos++) {
+                os << " " << hints[pos];
+            }
+            os << " 0\n";
+        }
+
+        if (clauseidx == emptyidx) break;
+    }
+
+    os.flush();
+    return os.good();
+}
@@ -0,0 +1,347 @@
+
+#include <iostream>
+#include "uksat.hpp"
+
+// Free vars looked ahead at each node, by default, and under a double
+// lookahead
+#define uksat_LOOKAHEAD_DEFCANDIDATES 64
+#define uksat_LOOKAHEAD_DLCANDIDATES 16
+
+// Reduction over which a literal gets a double lookahead, at first, and the
+// decay of the trigger at every node
+#define uksat_LOOKAHEAD_DLTRIGGER 32.0
+#define uksat_LOOKAHEAD_DLDECAY 0.95
+
+// Weight of the product of the reductions of both literals of a var in its
+// score, over their sum (as in march)
+#define uksat_LOOKAHEAD_MIXWEIGHT 1024.0
+
+// How many nodes are searched between two time checks
+#define uksat_LOOKAHEAD_TIMESTEP 16
+
+
+uksat::LookaheadSolver::LookaheadSolver(CnfFormula& _formula)
+: PropagatingSolver(_formula)
+, maxcandidates(uksat_LOOKAHEAD_DEFCANDIDATES)
+, stamp(0)
+, dltrigger(uksat_LOOKAHEAD_DLTRIGGER)
+, nnodes(0)
+, nprobes(0)
+, nfailed(0)
+, ndoublelookaheads(0)
+, ndlfailed(0)
+, ndlcachehits(0)
+{
+
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters/Setters ]
+ */
+
+
+std::size_t uksat::LookaheadSolver::getmaxcandidates() const {
+    return maxcandidates;
+}
+
+
+void uksat::LookaheadSolver::setmaxcandidates(std::size_t ncandidates) {
+    if (ncandidates > 0) maxcandidates = ncandidates;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Solving ]
+ */
+
+
+// Chronological DPLL, branching on the literal picked by the lookahead of
+// each node. Formulas with cardinality constraints are left undefined.
+bool uksat::LookaheadSolver::query() {
+    start();
+
+    if (isstarted() && formula.getncardinalities()) {
+        finish(0);
+
+    } else if (isstarted()) {
+        bool ok = true;
+        load();
+
+        for (std::size_t clauseidx = 0; ok && clauseidx < static_cast<std::size_t>(formula.getnclauses()); clauseidx++) {
+            CnfFormula::Clause clause = formula[clauseidx];
+            if (clause.empty()) ok = false;
+            else if (clause.size() == 1) ok = assign(*clause.begin());
+        }
+        ok = ok && propagate();
+
+        while (!isfinished()) {
+            int branchlit = 0;
+            if (ok) ok = lookahead(branchlit);
+
+            if (ok && !branchlit) {
+                for (int var = 1; var <= formula.getnvars(); var++) {
+                    if (values[var]) partial.assign(var, values[var] > 0);
+                }
+                finish(1);
+
+            } else if (ok) {
+                leveltrails.push_back(trail.size());
+                levellits.push_back(branchlit);
+                levelflips.push_back(false);
+                levelnodes.push_back(++nnodes);
+                assign(branchlit);
+                ok = propagate();
+
+            } else {
+                // The decisions flipped already are undone with the first
+                // one that wasn't
+                while (!levelflips.empty() && levelflips.back()) {
+                    leveltrails.pop_back();
+                    levellits.pop_back();
+                    levelflips.pop_back();
+                    levelnodes.pop_back();
+                }
+
+                if (levelflips.empty()) {
+                    finish(-1);
+
+                } else {
+                    nconflicts++;
+                    undo(leveltrails.back());
+                    levellits.back() = -levellits.back();
+                    levelflips.back() = true;
+                    levelnodes.back() = ++nnodes;
+                    assign(levellits.back());
+                    ok = propagate();
+                }
+            }
+
+            if (!isfinished() && !(nnodes % uksat_LOOKAHEAD_TIMESTEP) && !intime()) finish(0);
+        }
+    }
+
+    return issatisfied();
+}
+
+
+void uksat::LookaheadSolver::printstats(std::ostream& os) {
+    Solver::printstats(os);
+    os << "\tnodes: " << nnodes << std::endl;
+    os << "\tprobes: " << nprobes << std::endl;
+    os << "\tfailedlits: " << nfailed << std::endl;
+    os << "\tdoublelookaheads: " << ndoublelookaheads << std::endl;
+    os << "\tdlfailedlits: " << ndlfailed << std::endl;
+    os << "\tdlcachehits: " << ndlcachehits << std::endl;
+}
+
+
+std::size_t uksat::LookaheadSolver::getmemory() const {
+    return PropagatingSolver::getmemory() + memoryof(occurrences) + occurrencearena.getmemory()
+        + memoryof(clausestamps);
+}
+
+
+void uksat::LookaheadSolver::clear() {
+    PropagatingSolver::clear();
+    occurrences.clear();
+    occurrencearena.reset();
+    clausestamps.clear();
+    stamp = 0;
+    leveltrails.clear();
+    levellits.clear();
+    levelflips.clear();
+    levelnodes.clear();
+    candidates.clear();
+    dlcandidates.clear();
+    dllevels.clear();
+    dlnodes.clear();
+    dltrigger = uksat_LOOKAHEAD_DLTRIGGER;
+    nnodes = nprobes = nfailed = ndoublelookaheads = ndlfailed = ndlcachehits = 0;
+}
+
+
+void uksat::LookaheadSolver::load() {
+    std::size_t nvars = formula.getnvars();
+
+    // Unit clauses are assigned before searching
+    loadwatches();
+    occurrences.clear();
+    occurrencearena.reset();
+    occurrences.assign(2 * nvars + 2, IndexList(IndexList::allocator_type(&occurrencearena)));
+    clausestamps.assign(formula.getnclauses(), 0);
+    stamp = 0;
+    leveltrails.clear();
+    levellits.clear();
+    levelflips.clear();
+    levelnodes.clear();
+    dllevels.assign(2 * nvars + 2, -1);
+    dlnodes.assign(2 * nvars + 2, 0);
+    dltrigger = uksat_LOOKAHEAD_DLTRIGGER;
+
+    for (std::size_t clauseidx = 0; clauseidx < static_cast<std::size_t>(formula.getnclauses()); clauseidx++) {
+        CnfFormula::Clause clause = formula[clauseidx];
+        if (clause.size() > 2) {
+            for (CnfFormula::Clause::const_iterator it = clause.begin(); it != clause.end(); ++it) {
+                occurrences[uksat_LITIDX(*it)].push_back(clauseidx);
+            }
+        }
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Lookahead ]
+ */
+
+
+// Looks ahead on the candidates, over again while failed literals are found
+// (their negations change the reductions), and picks the var with the best
+// score. Its literal with the smaller reduction is branched on first, as the
+// likelier to be satisfiable. Returns false on a conflict, and leaves the
+// literal 0 once every var is assigned.
+bool uksat::LookaheadSolver::lookahead(int& branchlit) {
+    bool failed = true;
+    dltrigger *= uksat_LOOKAHEAD_DLDECAY;
+
+    while (failed) {
+        double bestscore = -1.0;
+        failed = false;
+        branchlit = 0;
+        selectcandidates(candidates, maxcandidates);
+
+        for (std::vector<int>::const_iterator it = candidates.begin(); it != candidates.end() && !failed; ++it) {
+            int var = *it;
+            int posscore = probe(var);
+            int negscore = posscore < 0 ? 0 : probe(-var);
+
+            if (posscore < 0 || negscore < 0) {
+                nfailed++;
+                assign(posscore < 0 ? -var : var);
+                if (!propagate()) return false;
+                failed = true;
+
+            } else {
+                double score = uksat_LOOKAHEAD_MIXWEIGHT * posscore * negscore + posscore + negscore;
+                if (score > bestscore) {
+                    bestscore = score;
+                    branchlit = posscore <= negscore ? var : -var;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+// Propagates the literal and undoes it. Returns its reduction, or -1 if it's
+// failed (by itself, or by its double lookahead).
+int uksat::LookaheadSolver::probe(int lit) {
+    std::size_t trailsize = trail.size();
+    int score = -1;
+
+    nprobes++;
+    assign(lit);
+    if (propagate()) {
+        score = reduction(trailsize);
+
+        if (score > dltrigger && iscached(lit)) {
+            ndlcachehits++;
+
+        } else if (score > dltrigger) {
+            if (!doublelookahead()) {
+                score = -1;
+            } else {
+                dllevels[uksat_LITIDX(lit)] = levelnodes.size();
+                dlnodes[uksat_LITIDX(lit)] = levelnodes.empty() ? 0 : levelnodes.back();
+                dltrigger = score;
+            }
+        }
+    }
+    undo(trailsize);
+
+    return score;
+}
+
+
+// Looks ahead on both literals of the candidates under the literal (already
+// propagated). The negations of the failed ones are kept until the literal
+// is undone, so the literal is failed if both of a var are.
+bool uksat::LookaheadSolver::doublelookahead() {
+    ndoublelookaheads++;
+    selectcandidates(dlcandidates, uksat_LOOKAHEAD_DLCANDIDATES);
+
+    for (std::vector<int>::const_iterator it = dlcandidates.begin(); it != dlcandidates.end(); ++it) {
+        for (int sign = 1; sign >= -1 && !values[*it]; sign -= 2) {
+            std::size_t trailsize = trail.size();
+            assign(sign * *it);
+            bool ok = propagate();
+            undo(trailsize);
+
+            if (!ok) {
+                assign(-sign * *it);
+                if (!propagate()) {
+                    ndlfailed++;
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+// New binary clauses: those of three literals or more left with two
+// unassigned ones (and none true) by the literals assigned since `trailsize`
+int uksat::LookaheadSolver::reduction(std::size_t trailsize) {
+    int nbinaries = 0;
+
+    if (!++stamp) {
+        clausestamps.assign(clausestamps.size(), 0);
+        stamp = 1;
+    }
+
+    for (std::size_t idx = trailsize; idx < trail.size(); idx++) {
+        const IndexList& clauseidxs = occurrences[uksat_LITIDX(-trail[idx])];
+
+        for (IndexList::const_iterator it = clauseidxs.begin(); it != clauseidxs.end(); ++it) {
+            if (clausestamps[*it] == stamp) continue;
+            clausestamps[*it] = stamp;
+
+            CnfFormula::Clause clause = formula[*it];
+            int nfree = 0;
+            bool sat = false;
+            for (CnfFormula::Clause::const_iterator iv = clause.begin(); iv != clause.end() && !sat && nfree <= 2; ++iv) {
+                int truth = value(*iv);
+                if (truth > 0) sat = true;
+                else if (!truth) nfree++;
+            }
+            if (!sat && nfree == 2) nbinaries++;
+        }
+    }
+
+    return nbinaries;
+}
+
+
+// The first free vars of the frequency order
+void uksat::LookaheadSolver::selectcandidates(std::vector<int>& cands, std::size_t maxcands) {
+    cands.clear();
+    for (std::vector<int>::const_iterator it = formula.getvarorder().begin(); it != formula.getvarorder().end() && cands.size() < maxcands; ++it) {
+        int var = uksat_NORMALLIT(*it);
+        if (!values[var]) cands.push_back(var);
+    }
+}
+
+
+// Whether a double lookahead on the literal found nothing at a node the
+// current one is below (or is)
+bool uksat::LookaheadSolver::iscached(int lit) const {
+    int level = dllevels[uksat_LITIDX(lit)];
+    std::size_t node = dlnodes[uksat_LITIDX(lit)];
+
+    return level >= 0 && static_cast<std::size_t>(level) <= levelnodes.size()
+        && node == (level ? levelnodes[level - 1] : 0);
+}
@@ -5,6 +5,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <locale>
+#include <unistd.h>
 #include "uksat.hpp"
 #include "ezOptionParser.hpp"
 
@@ -13,16 +14,16 @@
 #define RETOK      0
 #define RETERR     1
 #define RETEARG    2
-#define RETSAT     10
-#define RETUNSAT   20
-#define RETUNDEF   30
-#define RETTIMEOUT 40
+#define RETSAT     uksat_SATCODE
+#define RETUNSAT   uksat_UNSATCODE
+#define RETUNDEF   uksat_UNDEFCODE
+#define RETTIMEOUT uksat_TIMEOUTCODE
 
 // For the option parsing
 #define EXAMPLETEXT  "Simplest usage: `" uksat_NAME " in.cnf`"
 #define OVERVIEWTEXT "A minimalistic SAT WatchedDpllSolver."
 #define USAGETEXT     uksat_NAME " [OPTIONS] <INPUT> <OUTPUT>\n" \
-	"If <INPUT> equals \"-\", STDIN is used.\n" \
+	"If <INPUT> equals \"-\", STDIN is used. Otherwise it may be compressed (gzip, xz or bzip2).\n" \
 	"If <OUTPUT> equals \"-\", STDOUT is used."
 
 #define HEADERTEXT \
@@ -54,6 +55,24 @@ enum EOption {
     , TIMELIMIT   // -t=NUM  Specifies the time limit, in seconds
     , PRINTMAP    // -m      Prints the partial map (always before the formula)
     , SOLFILE     // -s=FILE Provides a solution file
+    , SIMPLIFY    // -S      Simplifies the formula before solving
+    , MAXPROBES   // --probes=NUM Limits the number of probed variables
+    , VERIFY      // --verify Verifies the solution file instead of solving
+    , PROOFFILE   // --proof=FILE Writes a DRAT proof of unsatisfiability
+    , TEXTPROOF   // --text-proof Writes the proof as text instead of binary
+    , SAVEFML     // --save=FILE Saves the loaded formula (binary if FILE ends in .ukb)
+    , PARSETHREADS // --parse-threads=NUM Sets the threads parsing the input file
+    , SERVE       // --serve  Solves a stream of formulas from STDIN
+    , SOCKET      // --socket=PATH Solves streams of formulas from a Unix socket
+    , JOBS        // --jobs=NUM Sets the workers solving the streamed formulas
+    , BATCH       // --batch=DIR Solves every formula in a directory, as `waf batch`
+    , ALLSAT      // --all    Enumerates every model
+    , COUNTLIMIT  // --count-limit=NUM Enumerates up to NUM models
+    , PROJECT     // --project=VARS Enumerates the models over VARS only
+    , COUNT       // --count  Counts the models exactly
+    , BREAKSYM    // --break-symmetries Adds symmetry-breaking clauses before solving
+    , LOOKAHEAD   // --lookahead Solves with the lookahead solver
+    , MEMLIMIT    // --mem-limit=NUM Specifies the memory limit, in megabytes
 };
 
 struct OptionDescriptor {
@@ -80,12 +99,30 @@ const OptionDescriptor descriptors[] = {
 , { RANDSEED,   false,    1,   '\0',   "d",    "-r",  "--rseed",    "",     "Sets the random seed to NUM."}
 , { SEQVAR,     false,    0,   '\0',   NULL,   "-R",  "--no-rand",  "",     "Deactivates random var selection (sequential selection)."}
 , { PRINTFML,   false,    0,   '\0',   NULL,   "-p",  "--printfml", "",     "Prints the formula in the output file (after the results)."}
-, { WATCHLIT,   false,    0,   '\0',   NULL,   "-w",  "--watch",    "",     "Activates watched literals." }
-, { NOWATCHLIT, false,    0,   '\0',   NULL,   "-W",  "--no-watch", "",     "Deactivates watched literals."}
+, { WATCHLIT,   false,    0,   '\0',   NULL,   "-w",  "--watch",    "",     "Activates watched literals (small formulas are not enumerated)." }
+, { NOWATCHLIT, false,    0,   '\0',   NULL,   "-W",  "--no-watch", "",     "Deactivates watched literals (small formulas are not enumerated)."}
 , { NOSOLVE,    false,    0,   '\0',   NULL,   "-A",  "--no-solve", "",     "Don't solve the formula. Useful with `-p`."}
 , { TIMELIMIT,  false,    1,   '\0',   NULL,   "-t",  "--maxtime",  "",     "Sets the maximum execution time, in seconds."}
 , { PRINTMAP,   false,    0,   '\0',   NULL,   "-m",  "--printmap", "",     "Prints the partial map."}
-, { SOLFILE,    false,    1,   '\0',   NULL,   "-s",  "--solfile",  "",     "Specifies a solution file to open."}
+, { SOLFILE,    false,    1,   '\0',   NULL,   "-s",  "--solfile",  "",     "Specifies a solution file to verify (implies `--verify`)."}
+, { SIMPLIFY,   false,    0,   '\0',   NULL,   "-S",  "--simplify", "",     "Simplifies the formula (failed literals, equivalent literals) before solving."}
+, { MAXPROBES,  false,    1,   '\0',   "u4",   NULL,  "--probes",   "",     "Sets the maximum number of variables probed by `-S`."}
+, { VERIFY,     false,    0,   '\0',   NULL,   NULL,  "--verify",   "",     "Checks the solution given by `-s` against the formula, instead of solving it."}
+, { PROOFFILE,  false,    1,   '\0',   NULL,   NULL,  "--proof",    "",     "Writes a binary DRAT proof to FILE (\"-\" for STDOUT, \"|cmd\" to pipe it into `cmd`)."}
+, { TEXTPROOF,  false,    0,   '\0',   NULL,   NULL,  "--text-proof", "",   "Writes the proof given by `--proof` in the text DRAT format."}
+, { SAVEFML,    false,    1,   '\0',   NULL,   NULL,  "--save",     "",     "Saves the formula as loaded to FILE, in the binary format if it ends in `" uksat_BINARYEXT "` (loaded much faster)."}
+, { PARSETHREADS, false,  1,   '\0',   "u4",   NULL,  "--parse-threads", "", "Parses the input file with NUM threads (default: one per core, for big files)."}
+, { SERVE,      false,    0,   '\0',   NULL,   NULL,  "--serve",    "",     "Solves a stream of formulas from STDIN (no <INPUT>), writing a line for each result to STDOUT as \"<NUMBER> <RESULT> <TIME> [<MODEL> 0]\"."}
+, { SOCKET,     false,    1,   '\0',   NULL,   NULL,  "--socket",   "",     "Like `--serve`, but for each connection to a Unix socket created at PATH, until SIGINT or SIGTERM."}
+, { JOBS,       false,    1,   '\0',   "u4",   NULL,  "--jobs",     "",     "Solves the formulas given by `--serve` or `--batch` with NUM workers (default: one per core)."}
+, { BATCH,      false,    1,   '\0',   NULL,   NULL,  "--batch",    "",     "Solves every formula (*.cnf, *.dimacs) in DIR, smallest first, with and without watched literals, writing the timings to STDOUT as the CSV of `waf batch`."}
+, { ALLSAT,     false,    0,   '\0',   NULL,   NULL,  "--all",      "",     "Enumerates every model, writing them to STDOUT (one per line, as its literals followed by 0)."}
+, { COUNTLIMIT, false,    1,   '\0',   "u8",   NULL,  "--count-limit", "",  "Stops the enumeration after NUM models (implies `--all`)."}
+, { PROJECT,    false,   -1,   ',',    "u4",   NULL,  "--project",  "",     "Enumerates the models over the comma-separated VARS only, each one once (implies `--all`)."}
+, { COUNT,      false,    0,   '\0',   NULL,   NULL,  "--count",    "",     "Counts the models exactly (#SAT), without enumerating them, writing the count to STDOUT."}
+, { BREAKSYM,   false,    0,   '\0',   NULL,   NULL,  "--break-symmetries", "", "Finds the symmetries of the formula and adds clauses ruling out all but one assignment of each (only one of symmetric models is kept)."}
+, { LOOKAHEAD,  false,    0,   '\0',   NULL,   NULL,  "--lookahead", "",    "Solves with the lookahead DPLL solver (failed literals, best reduction), usually faster on hard random formulas."}
+, { MEMLIMIT,   false,    1,   '\0',   "u4",   NULL,  "--mem-limit", "",    "Sets the maximum memory (resident set) of the solver, in megabytes. Past it, the solver stops with an undefined result (\"MEMOUT\")."}
 , { NONE,       false,    0,   '\0',   NULL,   NULL,  NULL,         NULL,   NULL }
 };
 
@@ -100,12 +137,35 @@ struct ArgState {
 	double rseed;
 	bool printingfml;
 	bool watchinglits;
+	bool choosingsolver;
+	bool bruteforcing;
 	bool solvingfml;
     bool printingmap;
+    bool simplifying;
+    bool verifying;
+    bool proving;
+    bool textproof;
     int maxtime;
+    int maxprobes;
 	std::string inputname;
 	std::string outputname;
 	std::string solname;
+	std::string proofname;
+	std::string savename;
+	int parsethreads;
+	bool serving;
+	std::string socketname;
+	int njobs;
+	std::string batchname;
+	bool enumerating;
+	unsigned long long countlimit;
+	unsigned long long nmodels;
+	std::vector<int> projection;
+	bool counting;
+	std::string modelcount;
+	bool breakingsym;
+	bool lookingahead;
+	int maxmemory;
 
 	ArgState()
 		: exitcode(RETOK)
@@ -114,9 +174,26 @@ struct ArgState {
 		, rseed(0)
 		, printingfml(false)
 		, watchinglits(true)
+		, choosingsolver(true)
+		, bruteforcing(false)
 		, solvingfml(true)
         , printingmap(false)
+        , simplifying(false)
+        , verifying(false)
+        , proving(false)
+        , textproof(false)
         , maxtime(0)
+        , maxprobes(-1)
+        , parsethreads(0)
+        , serving(false)
+        , njobs(0)
+        , enumerating(false)
+        , countlimit(0)
+        , nmodels(0)
+        , counting(false)
+        , breakingsym(false)
+        , lookingahead(false)
+        , maxmemory(0)
 	{}
 
 	int isset(EOption option) { return optparser.isSet(descriptors[option].getname()); }
@@ -131,7 +208,14 @@ static void printversion(ArgState& arg);
 static void setupopts(ArgState& arg);
 static bool checkargs(ArgState& arg);
 static void printsummary(ArgState& arg, uksat::CnfFormula& cnf, uksat::Solver& partial);
+static void printsimplifier(ArgState& arg, uksat::Simplifier& simplifier);
+static void printsymmetries(ArgState& arg, uksat::SymmetryBreaker& breaker);
 static void printresults(ArgState& arg, uksat::CnfFormula& cnf, uksat::Solver& partial);
+static int evalverifier(ArgState& arg, uksat::Verifier& verifier);
+static void printverifier(ArgState& arg, uksat::Verifier& verifier);
+static void printproof(ArgState& arg, uksat::ProofWriter& proof);
+static int runserver(ArgState& arg);
+static int runbatch(ArgState& arg);
 
 int main(int argc, const char** argv) {
 	ArgState arg;
@@ -149,36 +233,32 @@ int main(int argc, const char** argv) {
 		return RETOK;
 	}
 
-	if (checkargs(arg)) {
+	if (checkargs(arg) && arg.serving) {
+		runserver(arg);
+
+	} else if (arg.exitcode == RETOK && !arg.batchname.empty()) {
+		runbatch(arg);
+
+	} else if (arg.exitcode == RETOK) {
 		bool keepgoing = true;
         int sat = 0;
 		uksat::CnfFormula cnf;
-        uksat::SimpleDpllSolver simplesolver(cnf);
-        uksat::WatchedDpllSolver watchedsolver(cnf);
-        uksat::Solver& solver = arg.watchinglits ? watchedsolver : simplesolver;
-        
-		// Setting configuration
-        if (arg.maxtime) solver.setmaxtime(static_cast<double>(arg.maxtime));
-        if (arg.isverbose()) solver.setlogstream(std::cerr);
-        if (arg.isdebug()) solver.addlogtype(uksat::LOG_ALL);
+        uksat::Simplifier simplifier(cnf);
+        uksat::SymmetryBreaker breaker(cnf);
+        uksat::ProofWriter proof;
         
 		// Input and output
 		std::istream* is = NULL;
 		std::ostream* os = NULL;
         std::istream* ss = NULL;
-		std::stringstream ibuf;
 		std::stringstream sbuf;
 		std::ifstream ifile;
 		std::ofstream ofile;
         std::ifstream sfile;
 
-		// Opening input file
+		// Opening input file (STDIN is only read as a stream when verifying)
 		if (arg.inputname.compare("-") == 0) {
-			std::string buf;
-			is = &ibuf;
-			while (std::getline(std::cin, buf)) {
-				ibuf << buf << std::endl;
-			}
+			is = &std::cin;
 
 		} else {
 			is = &ifile;
@@ -208,14 +288,11 @@ int main(int argc, const char** argv) {
         
         // Opening solution file
         if (keepgoing && !arg.solname.empty()) {
-            if (arg.inputname.compare("-") == 0) {
-                std::string buf;
-                is = &sbuf;
-                while (std::getline(std::cin, buf)) {
-                    sbuf << buf << std::endl;
-                }
+            if (arg.solname.compare("-") == 0) {
+                ss = &std::cin;
                 
             } else {
+                ss = &sfile;
                 sfile.open(arg.solname.c_str());
 
                 if (!sfile.is_open()) {
@@ -226,24 +303,126 @@ int main(int argc, const char** argv) {
             }
 		}
         
-		// Loading formula
-		if (keepgoing && !cnf.openfile(*is)) {
+		// Verifying the solution, no solver is needed
+		if (keepgoing && arg.verifying) {
+			uksat::Verifier verifier;
+			verifier.verify(*is, *ss);
+			evalverifier(arg, verifier);
+			printverifier(arg, verifier);
+			keepgoing = false;
+		}
+
+		// Loading formula (by name or from the descriptor, so that files are mapped)
+		cnf.setnthreads(arg.parsethreads);
+		if (keepgoing && !(ifile.is_open() ? cnf.openfile(arg.inputname.c_str()) : cnf.openfd(STDIN_FILENO))) {
 			std::cerr << "ERROR: Could not load the formula, or the formula is invalid." << std::endl;
 			keepgoing = false;
 		}
 
-		// Writing summary of current run and solving formula
+		// Saving the formula as loaded
+		if (keepgoing && !arg.savename.empty() && !cnf.savefile(arg.savename.c_str())) {
+			std::cerr << "ERROR: Could not save the formula to \"" << arg.savename << "\"." << std::endl;
+			arg.exitcode = RETERR;
+			keepgoing = false;
+		}
+
+		// The propagations of cardinality constraints can't be proved in DRAT,
+		// and the counter and the lookahead solver only know clauses
+		if (keepgoing && cnf.getncardinalities() && (arg.proving || arg.counting || arg.lookingahead)) {
+			std::cerr << "ERROR: " << (arg.proving ? "Proofs can't be written" : (arg.counting ? "Models can't be counted" : "The lookahead solver can't be used"))
+				<< " for formulas with cardinality constraints." << std::endl;
+			arg.exitcode = RETERR;
+			keepgoing = false;
+		}
+
+		// Opening the proof, before the simplifier changes the formula
+		if (keepgoing && arg.proving) {
+			proof.setbinary(!arg.textproof);
+
+			if (proof.open(arg.proofname.c_str())) {
+				simplifier.setproof(&proof);
+
+			} else {
+				std::cerr << "ERROR: Could not open proof file \"" << arg.proofname << "\"." << std::endl;
+				arg.exitcode = RETERR;
+				keepgoing = false;
+			}
+		}
+
+		// Simplifying formula
+		if (keepgoing && arg.simplifying) {
+            if (arg.maxprobes >= 0) simplifier.setmaxprobes(arg.maxprobes);
+            simplifier.simplify();
+            printsimplifier(arg, simplifier);
+		}
+
+		// Breaking symmetries, on what is left of the formula
+		if (keepgoing && arg.breakingsym) {
+            breaker.breaksymmetries();
+            printsymmetries(arg, breaker);
+		}
+
+		// Choosing the solver (small formulas are enumerated, unless a DPLL
+		// solver was explicitly asked for or a proof is needed), building only
+		// that one, and setting its configuration
+        uksat::Solver* chosensolver = NULL;
+		if (keepgoing) {
+            uksat::SolverTypeId solvertype = arg.counting
+                ? uksat::SOLVER_COUNTING
+                : (arg.lookingahead
+                    ? uksat::SOLVER_LOOKAHEAD
+                    : uksat::choosesolver(cnf, arg.choosingsolver && !arg.proving && !arg.enumerating, arg.watchinglits));
+            chosensolver = uksat::newsolver(cnf, solvertype);
+            arg.bruteforcing = solvertype == uksat::SOLVER_BRUTEFORCE;
+            if (arg.maxtime) chosensolver->setmaxtime(static_cast<double>(arg.maxtime));
+            if (arg.maxmemory) chosensolver->setmaxmemory(static_cast<std::size_t>(arg.maxmemory) << 20);
+            if (arg.isverbose()) chosensolver->setlogstream(std::cerr);
+            if (arg.isdebug()) chosensolver->addlogtype(uksat::LOG_ALL);
+            if (proof.isopen()) chosensolver->setproof(&proof);
+		}
+
+		// Writing summary of current run and solving formula (or enumerating
+		// its models, with a DPLL solver)
 		if (keepgoing) {
+            uksat::Solver& solver = *chosensolver;
 			printsummary(arg, cnf, solver);
-			if (arg.solvingfml) {
+			if (arg.solvingfml && arg.enumerating) {
+                uksat::SimpleDpllSolver& dpllsolver = static_cast<uksat::SimpleDpllSolver&>(solver);
+                uksat::ProofWriter models;
+                models.setbinary(false);
+                models.open("-");
+                dpllsolver.setprojection(arg.projection);
+                dpllsolver.setmodelwriter(&models);
+                arg.nmodels = dpllsolver.enumerate(arg.countlimit);
+                sat = dpllsolver.issatisfied() ? 1 : (dpllsolver.isconflicting() ? -1 : 0);
+                if (!models.close()) {
+                    std::cerr << "ERROR: Could not write the models." << std::endl;
+                }
+                if (dpllsolver.getninvalidmodels()) {
+                    std::cerr << "ERROR: " << dpllsolver.getninvalidmodels()
+                        << " of the models found don't satisfy the formula." << std::endl;
+                }
+
+            } else if (arg.solvingfml) {
                 solver.query();
                 sat = solver.issatisfied() ? 1 : (solver.isconflicting() ? -1 : 0);
+                if (sat > 0 && arg.simplifying) simplifier.extend(solver.getpartial());
+
+                if (arg.counting && sat) {
+                    arg.modelcount = static_cast<uksat::CountingSolver&>(solver).getcount().str();
+                    std::cout << arg.modelcount << std::endl;
+                }
                 
             } else {
                 sat = solver.apply();
             }
 		}
 
+		// Closing the proof, so that it is complete before the result is out
+		if (proof.isopen() && !proof.close()) {
+			std::cerr << "ERROR: Could not write the proof to \"" << arg.proofname << "\"." << std::endl;
+		}
+
 		// Writing results to the output file, if asked to
 		if (keepgoing && (arg.printingmap || arg.printingfml) && os) {
 			const std::time_put<char>& tmput = std::use_facet <std::time_put<char> > (os->getloc());
@@ -254,7 +433,7 @@ int main(int argc, const char** argv) {
 		    tmput.put(*os, *os, ' ', now, pattern.data(), pattern.data() + pattern.length());
             
             if (arg.printingmap) {
-                cnf.savesolution(*os, solver);
+                cnf.savesolution(*os, *chosensolver);
 			}
             
 			if (arg.printingfml) {
@@ -264,14 +443,16 @@ int main(int argc, const char** argv) {
 
 		// Printing summary and setting final result
 		if (keepgoing) {
-            evalresult(arg, solver);
-			printresults(arg, cnf, solver);
+            evalresult(arg, *chosensolver);
+            printproof(arg, proof);
+			printresults(arg, cnf, *chosensolver);
 		}
 
 		// Closing files, if needed
 		if (ifile.is_open()) ifile.close();
 		if (ofile.is_open()) ofile.close();
 		if (sfile.is_open()) sfile.close();
+		delete chosensolver;
 	}
 
 	return arg.exitcode;
@@ -319,7 +500,7 @@ bool checkargs(ArgState& arg) {
 	std::vector<std::string> badOptions;
 	std::vector<std::string> badArgs;
 
-	if (arg.optparser.lastArgs.size() < 1) {
+	if (arg.optparser.lastArgs.size() < 1 && !arg.isset(SERVE) && !arg.isset(SOCKET) && !arg.isset(BATCH)) {
 		std::cerr << "ERROR: Input file not given." << std::endl;
 		std::cerr << "Check `" << uksat_NAME << " -h` for help." << std::endl;
 		ret = false;
@@ -376,17 +557,21 @@ bool checkargs(ArgState& arg) {
 
 		if (arg.isset(WATCHLIT)) {
 			arg.watchinglits = true;
+			arg.choosingsolver = false;
 		}
 
 		if (arg.isset(NOWATCHLIT)) {
 			arg.watchinglits = false;
+			arg.choosingsolver = false;
 		}
 
 		if (arg.isset(NOSOLVE)) {
 			arg.solvingfml = false;
 		}
 
-		arg.inputname = *arg.optparser.lastArgs[0];
+		if (arg.optparser.lastArgs.size() > 0) {
+			arg.inputname = *arg.optparser.lastArgs[0];
+		}
 		if (arg.optparser.lastArgs.size() > 1) {
 			arg.outputname = *arg.optparser.lastArgs[1];
 		}
@@ -403,11 +588,138 @@ bool checkargs(ArgState& arg) {
         
         if (arg.isset(SOLFILE)) {
             std::string solfilename;
-            arg.get(TIMELIMIT)->getString(solfilename);
+            arg.get(SOLFILE)->getString(solfilename);
             arg.solname = solfilename;
+            arg.verifying = true;
         }
 
-	} else {
+        if (arg.isset(VERIFY)) {
+            arg.verifying = true;
+        }
+
+        if (arg.isset(SIMPLIFY)) {
+            arg.simplifying = true;
+        }
+
+        if (arg.isset(MAXPROBES)) {
+            int maxprobes;
+            arg.get(MAXPROBES)->getInt(maxprobes);
+            arg.maxprobes = maxprobes;
+        }
+
+        if (arg.isset(PROOFFILE)) {
+            std::string prooffilename;
+            arg.get(PROOFFILE)->getString(prooffilename);
+            arg.proofname = prooffilename;
+            arg.proving = true;
+        }
+
+        if (arg.isset(TEXTPROOF)) {
+            arg.textproof = true;
+        }
+
+        if (arg.isset(PARSETHREADS)) {
+            arg.get(PARSETHREADS)->getInt(arg.parsethreads);
+        }
+
+        if (arg.isset(SAVEFML)) {
+            arg.get(SAVEFML)->getString(arg.savename);
+        }
+
+        if (arg.isset(SERVE)) {
+            arg.serving = true;
+        }
+
+        if (arg.isset(SOCKET)) {
+            arg.get(SOCKET)->getString(arg.socketname);
+            arg.serving = true;
+        }
+
+        if (arg.isset(JOBS)) {
+            arg.get(JOBS)->getInt(arg.njobs);
+        }
+
+        if (arg.isset(ALLSAT)) {
+            arg.enumerating = true;
+        }
+
+        if (arg.isset(COUNTLIMIT)) {
+            arg.get(COUNTLIMIT)->getULongLong(arg.countlimit);
+            arg.enumerating = true;
+        }
+
+        if (arg.isset(PROJECT)) {
+            arg.get(PROJECT)->getInts(arg.projection);
+            arg.enumerating = true;
+        }
+
+        if (arg.isset(COUNT)) {
+            arg.counting = true;
+        }
+
+        if (arg.isset(BATCH)) {
+            arg.get(BATCH)->getString(arg.batchname);
+        }
+
+        if (arg.isset(BREAKSYM)) {
+            arg.breakingsym = true;
+        }
+
+        if (arg.isset(LOOKAHEAD)) {
+            arg.lookingahead = true;
+        }
+
+        if (arg.isset(MEMLIMIT)) {
+            arg.get(MEMLIMIT)->getInt(arg.maxmemory);
+        }
+
+        if (arg.maxmemory && (arg.serving || !arg.batchname.empty())) {
+            // The memory is measured for the whole process, not by worker
+            std::cerr << "ERROR: `--mem-limit` can't be used with `--serve`, `--socket` or `--batch`." << std::endl;
+            ret = false;
+
+        } else if (!arg.batchname.empty() && (arg.serving || arg.enumerating || arg.counting || arg.verifying || arg.proving || arg.breakingsym || arg.lookingahead || !arg.savename.empty() || !arg.inputname.empty())) {
+            std::cerr << "ERROR: `--batch` reads its own formulas, and only solves them." << std::endl;
+            ret = false;
+
+        } else if (arg.enumerating && (arg.serving || arg.verifying || arg.proving || arg.simplifying)) {
+            // The simplifier keeps the formula satisfiable, not its models
+            std::cerr << "ERROR: `--all` can't be used with `--serve`, `--verify`, `--proof` or `-S`." << std::endl;
+            ret = false;
+
+        } else if (arg.counting && (arg.enumerating || arg.serving || arg.verifying || arg.proving || arg.simplifying || arg.printingmap)) {
+            // No model is kept, only the count
+            std::cerr << "ERROR: `--count` can't be used with `--all`, `--serve`, `--verify`, `--proof`, `-S` or `-m`." << std::endl;
+            ret = false;
+
+        } else if (arg.breakingsym && (arg.enumerating || arg.counting || arg.serving || arg.verifying || arg.proving)) {
+            // The clauses added rule out models, and can't be derived in DRAT
+            std::cerr << "ERROR: `--break-symmetries` can't be used with `--all`, `--count`, `--serve`, `--verify` or `--proof`." << std::endl;
+            ret = false;
+
+        } else if (arg.lookingahead && (arg.enumerating || arg.counting || arg.serving || arg.proving)) {
+            std::cerr << "ERROR: `--lookahead` can't be used with `--all`, `--count`, `--serve` or `--proof`." << std::endl;
+            ret = false;
+
+        } else if (arg.serving && (arg.verifying || arg.proving || !arg.savename.empty() || !arg.inputname.empty())) {
+            std::cerr << "ERROR: `--serve` and `--socket` read their own formulas, and only solve them." << std::endl;
+            ret = false;
+
+        } else if (arg.verifying && arg.solname.empty()) {
+            std::cerr << "ERROR: `--verify` needs a solution file, given by `-s`." << std::endl;
+            ret = false;
+
+        } else if (arg.verifying && arg.solname.compare("-") == 0 && arg.inputname.compare("-") == 0) {
+            std::cerr << "ERROR: The formula and the solution can't both be read from STDIN." << std::endl;
+            ret = false;
+
+        } else if (arg.proving && arg.proofname.compare("-") == 0 && arg.outputname.compare("-") == 0) {
+            std::cerr << "ERROR: The proof and the output can't both be written to STDOUT." << std::endl;
+            ret = false;
+        }
+	}
+
+	if (!ret) {
 		arg.exitcode = RETEARG;
 	}
 
@@ -415,27 +727,78 @@ bool checkargs(ArgState& arg) {
 }
 
 
-int evalresult(ArgState& arg, uksat::Solver& solver) {
-    int ret = RETUNDEF;
-    const char* str = "UNDEFINED";
-    
-    if (solver.hastimeout()) {
-        ret = RETTIMEOUT;
-        str = "TIMEOUT";
-        
-    } else if (solver.issatisfied()) {
-        ret = RETSAT;
-        str = "SATISFIABLE";
-        
-    } else if (solver.isconflicting()) {
-        ret = RETUNSAT;
-        str = "UNSATISFIABLE";
+// Solves every formula streamed to the server, with the same solver choice
+// as for a single formula
+int runserver(ArgState& arg) {
+    uksat::Server server;
+    bool served;
+
+    server.setnworkers(arg.njobs);
+    server.setmaxtime(static_cast<double>(arg.maxtime));
+    server.setwatching(arg.watchinglits);
+    server.setchoosing(arg.choosingsolver);
+    server.setsimplifying(arg.simplifying);
+    server.setmaxprobes(arg.maxprobes);
+
+    if (!server.start()) {
+        std::cerr << "ERROR: Could not start the workers." << std::endl;
+        served = false;
+
+    } else if (arg.socketname.empty()) {
+        served = server.serve(STDIN_FILENO, STDOUT_FILENO);
+
+    } else {
+        served = server.listen(arg.socketname.c_str());
+        if (!served) std::cerr << "ERROR: Could not serve on the socket \"" << arg.socketname << "\"." << std::endl;
     }
+
+    if (arg.isverbose()) {
+        std::cerr << uksat_RELEASENAME << std::endl << "SERVER:" << std::endl;
+        std::cerr << "\tsocketname: '" << (arg.socketname.empty() ? "<stdin>" : arg.socketname.c_str()) << "'" << std::endl;
+        std::cerr << "\tworkers: " << arg.njobs << std::endl;
+        std::cerr << "\tserved: " << server.getnserved() << std::endl;
+    }
+
+    arg.exitcode = served ? RETOK : RETERR;
+    return arg.exitcode;
+}
+
+
+// Solves every formula in the directory, writing a CSV row for each one
+int runbatch(ArgState& arg) {
+    uksat::Batch batch;
+    bool ran = false;
+
+    batch.setnworkers(arg.njobs);
+    batch.setmaxtime(static_cast<double>(arg.maxtime));
+    batch.setwatching(arg.watchinglits);
+    batch.setchoosing(arg.choosingsolver);
+
+    if (!batch.find(arg.batchname.c_str())) {
+        std::cerr << "ERROR: No formulas found in \"" << arg.batchname << "\"." << std::endl;
+
+    } else {
+        ran = batch.run(std::cout);
+    }
+
+    if (arg.isverbose()) {
+        std::cerr << uksat_RELEASENAME << std::endl << "BATCH:" << std::endl;
+        std::cerr << "\tbatchname: '" << arg.batchname << "'" << std::endl;
+        std::cerr << "\tworkers: " << arg.njobs << std::endl;
+        std::cerr << "\tformulas: " << batch.getnformulas() << std::endl;
+        std::cerr << "\tstolen: " << batch.getnstolen() << std::endl;
+    }
+
+    arg.exitcode = ran ? RETOK : RETERR;
+    return arg.exitcode;
+}
+
+
+int evalresult(ArgState& arg, uksat::Solver& solver) {
+    arg.exitcode = uksat::resultcode(solver);
+    arg.resultstr = uksat::resultname(solver);
     
-    arg.exitcode = ret;
-    arg.resultstr = str;
-    
-    return ret;
+    return arg.exitcode;
 }
 
 void printhelp(ArgState& arg) {
@@ -459,9 +822,15 @@ void printsummary(ArgState& arg, uksat::CnfFormula& cnf, uksat::Solver& partial)
 	std::cerr << "\trseed: " << arg.rseed << std::endl;
 	std::cerr << "\tprintingfml: " << (arg.printingfml ? "true" : "false") << std::endl;
 	std::cerr << "\twatchinglits: " << (arg.watchinglits ? "true" : "false") << std::endl;
+	std::cerr << "\tbruteforcing: " << (arg.bruteforcing ? "true" : "false") << std::endl;
 	std::cerr << "\tsolvingfml: " << (arg.solvingfml ? "true" : "false") << std::endl;
+	std::cerr << "\tsimplifying: " << (arg.simplifying ? "true" : "false") << std::endl;
+	std::cerr << "\tbreakingsym: " << (arg.breakingsym ? "true" : "false") << std::endl;
+	std::cerr << "\tlookingahead: " << (arg.lookingahead ? "true" : "false") << std::endl;
+	std::cerr << "\tproving: " << (arg.proving ? "true" : "false") << std::endl;
 	std::cerr << "FORMULA:" << std::endl;
 	std::cerr << "\tnumclauses: " << cnf.getnclauses() << std::endl;
+	std::cerr << "\tnumcardinalities: " << cnf.getncardinalities() << std::endl;
 	std::cerr << "\tnumvars: " << cnf.getnvars() << std::endl;
     std::cerr << "\tVariable Ordering: ";
     const char* sep = "";
@@ -476,10 +845,53 @@ void printsummary(ArgState& arg, uksat::CnfFormula& cnf, uksat::Solver& partial)
     std::cerr << std::endl << std::endl;
 }
 
+void printsimplifier(ArgState& arg, uksat::Simplifier& simplifier) {
+	if (!arg.isverbose()) return;
+
+	std::cerr << "SIMPLIFIER:" << std::endl;
+	std::cerr << "\tprobes: " << simplifier.getnprobes() << std::endl;
+	std::cerr << "\tfailedlits: " << simplifier.getnfailed() << std::endl;
+	std::cerr << "\tequivalences: " << simplifier.getnequivalences() << std::endl;
+	std::cerr << "\tremovedclauses: " << simplifier.getnremoved() << std::endl;
+}
+
+void printsymmetries(ArgState& arg, uksat::SymmetryBreaker& breaker) {
+	if (!arg.isverbose()) return;
+
+	std::cerr << "SYMMETRIES:" << std::endl;
+	std::cerr << "\tgenerators: " << breaker.getngenerators() << std::endl;
+	std::cerr << "\taddedclauses: " << breaker.getnadded() << std::endl;
+	std::cerr << "\tsteps: " << breaker.getnsteps() << std::endl;
+}
+
+void printproof(ArgState& arg, uksat::ProofWriter& proof) {
+	if (!arg.isverbose() || !arg.proving) return;
+
+	std::cerr << "PROOF:" << std::endl;
+	std::cerr << "\tproofname: '" << (arg.proofname.compare("-") == 0 ? "<stdout>" : arg.proofname.c_str()) << "'" << std::endl;
+	std::cerr << "\tformat: " << (proof.isbinary() ? "binary" : "text") << std::endl;
+	std::cerr << "\taddedclauses: " << proof.getnadded() << std::endl;
+	std::cerr << "\tdeletedclauses: " << proof.getndeleted() << std::endl;
+	std::cerr << "\tbytes: " << proof.getnbytes() << std::endl;
+}
+
 void printresults(ArgState& arg, uksat::CnfFormula& cnf, uksat::Solver& solver) {
 	if (!arg.solvingfml) return;
 
-	if (arg.isverbose()) {
+	// The stats are always written after a memout, to show where it went
+	if (arg.isverbose() || solver.hasmemout()) {
+		std::cerr << "STATS:" << std::endl;
+		solver.printstats(std::cerr);
+		if (arg.enumerating) std::cerr << "\tmodels: " << arg.nmodels << std::endl;
+		if (arg.counting) std::cerr << "\tmodels: " << (arg.modelcount.empty() ? "0" : arg.modelcount) << std::endl;
+	}
+
+	// When enumerating or counting, the models stand for the check of the last one
+	if (arg.enumerating) {
+		std::cerr << arg.resultstr << " " << solver.getelapsedtime() << " " << arg.nmodels << std::endl;
+	} else if (arg.counting) {
+		std::cerr << arg.resultstr << " " << solver.getelapsedtime() << " " << (arg.modelcount.empty() ? "0" : arg.modelcount) << std::endl;
+	} else if (arg.isverbose()) {
 		std::cerr << arg.resultstr << " " << solver.getelapsedtime()
                 << " " << solver.apply() << std::endl; //partial.clockbegin << " " << partial.clockend << " " << CLOCKS_PER_SEC  << std::endl;
 	} else {
@@ -488,3 +900,62 @@ void printresults(ArgState& arg, uksat::CnfFormula& cnf, uksat::Solver& solver)
 	}
 }
 
+
+int evalverifier(ArgState& arg, uksat::Verifier& verifier) {
+    int ret = RETUNDEF;
+    const char* str = "UNVERIFIABLE"; // Unsatisfiability claims can't be checked
+    
+    if (!verifier.isvalid()) {
+        ret = RETERR;
+        str = "INVALID";
+        
+    } else if (verifier.getclaim() >= 0) {
+        if (verifier.getresult() > 0) {
+            ret = RETSAT;
+            str = "VERIFIED";
+            
+        } else if (verifier.getresult() < 0) {
+            str = "FALSIFIED";
+            
+        } else {
+            str = "INCOMPLETE";
+        }
+    }
+    
+    arg.exitcode = ret;
+    arg.resultstr = str;
+    
+    return ret;
+}
+
+void printverifier(ArgState& arg, uksat::Verifier& verifier) {
+    if (arg.isverbose()) {
+        int claim = verifier.getclaim();
+        std::cerr << uksat_RELEASENAME << std::endl << "VERIFIER:" << std::endl;
+        std::cerr << "\tinputname: '" << (arg.inputname.compare("-") == 0 ? "<stdin>" : arg.inputname.c_str()) << "'" << std::endl;
+        std::cerr << "\tsolname: '" << (arg.solname.compare("-") == 0 ? "<stdin>" : arg.solname.c_str()) << "'" << std::endl;
+        std::cerr << "\tclaim: " << (claim > 0 ? "SATISFIABLE" : (claim < 0 ? "UNSATISFIABLE" : "UNKNOWN")) << std::endl;
+        std::cerr << "\tnumvars: " << verifier.getnvars() << std::endl;
+        std::cerr << "\tnumclauses: " << verifier.getnclauses() << std::endl;
+        std::cerr << "\tcheckedclauses: " << verifier.getnchecked() << std::endl;
+    }
+    
+    if (verifier.ismalformed()) {
+        std::cerr << "ERROR: The solution is malformed (no \"s\" or \"v\" lines, or literals out of the formula's vars)." << std::endl;
+
+    } else if (!verifier.isvalid()) {
+        std::cerr << "ERROR: Could not read the formula, or the formula is invalid." << std::endl;
+    }
+    
+    if (verifier.isvalid() && verifier.getclaim() >= 0 && verifier.getfailedclause() >= 0) {
+        const std::vector<int>& lits = verifier.getfailedlits();
+        std::cerr << "c clause " << (verifier.getfailedclause() + 1)
+                << (verifier.getresult() < 0 ? " falsified:" : " not satisfied:");
+        for (std::vector<int>::const_iterator it = lits.begin(); it != lits.end(); ++it) {
+            std::cerr << " " << *it;
+        }
+        std::cerr << " 0" << std::endl;
+    }
+    
+    std::cerr << arg.resultstr << " " << verifier.getelapsedtime() << " " << verifier.getresult() << std::endl;
+}
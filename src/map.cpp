@@ -6,31 +6,37 @@ uksat::PartialMap::PartialMap() : mapsize(0) {
 
 
 uksat::PartialMap::PartialMap(int nvars) : mapsize(0) {
-    map.resize(nvars, Entry());
+    setnvars(nvars);
 }
 
 
 
 int uksat::PartialMap::getnvars() const {
-    return map.size();
+    return values.size();
 }
 
 
 void uksat::PartialMap::setnvars(int nvars) {
-    mapsize = 0;
-    map.clear();
-    map.resize(nvars, Entry());
+    clear();
+    values.resize(nvars, 0);
+    levels.resize(nvars, 0);
+    reasons.resize(nvars, -1);
+    watches.resize(2 * (nvars + 1), WatchList(std::less<std::size_t>(), WatchList::allocator_type(&arena)));
 }
 
 
-std::set<std::size_t>& uksat::PartialMap::getwatches(int var) {
-    int normvar = uksat_NORMALLIT(var);
-    int idx = normvar - 1;
-    //std::cerr << "GETWATCH normvar = " << normvar << ", var = " << var << ", idx = " << idx << std::endl;
-    if (var < 0)
-        return map[idx].fclauses;
-    else
-        return map[idx].tclauses;
+uksat::PartialMap::WatchList& uksat::PartialMap::getwatches(int var) {
+    return watches[uksat_LITIDX(var)];
+}
+
+
+int uksat::PartialMap::getreason(int var) const {
+    return reasons[uksat_NORMALLIT(var) - 1];
+}
+
+
+void uksat::PartialMap::setreason(int var, int reason) {
+    reasons[uksat_NORMALLIT(var) - 1] = reason;
 }
 
 
@@ -41,18 +47,22 @@ int uksat::PartialMap::size() const {
 
 void uksat::PartialMap::clear() {
     mapsize = 0;
-    map.clear();
+    values.clear();
+    levels.clear();
+    reasons.clear();
+    watches.clear();
+    arena.reset();
 }
 
 
 void uksat::PartialMap::assign(int var, int truth, int time) {
     int idx = uksat_NORMALLIT(var) - 1;
-    int val = map[idx].truth;
+    int val = values[idx];
     if (val && !truth) mapsize--;
     if (!val && truth) mapsize++;
-    map[idx].truthtime = time;
-    //std::cerr << "ASSIGN var = " << (idx + 1) << ", truth = " << truth << std::endl;
-    map[idx].truth = truth;
+    levels[idx] = time;
+    reasons[idx] = -1;
+    values[idx] = truth < 0 ? -1 : (truth > 0 ? 1 : 0);
 }
 
 
@@ -73,44 +83,46 @@ void uksat::PartialMap::unassign(int var) {
 
 bool uksat::PartialMap::isassigned(int var) const {
     int normalizedlit = uksat_NORMALLIT(var);
-    return normalizedlit-- ? !!map[normalizedlit].truth : false;
+    return normalizedlit-- ? !!values[normalizedlit] : false;
 }
 
 
 bool uksat::PartialMap::istrue(int var) const {
     int normalizedlit = uksat_NORMALLIT(var);
-    return normalizedlit-- ? uksat_BOOLVAL(var, map[normalizedlit].truth) : false;
+    return normalizedlit-- ? uksat_BOOLVAL(var, values[normalizedlit]) : false;
 }
 
 
 bool uksat::PartialMap::isfalse(int var) const {
     int normalizedlit = uksat_NORMALLIT(var);
-    return normalizedlit-- ? !uksat_BOOLVAL(var, map[normalizedlit].truth) : false;
+    return normalizedlit-- ? !uksat_BOOLVAL(var, values[normalizedlit]) : false;
 }
 
 
 int
 uksat::PartialMap::gettime(int normvar) {
     int normalizedlit = uksat_NORMALLIT(normvar);
-    return normalizedlit-- ? map[normalizedlit].truthtime : 0;
+    return normalizedlit-- ? levels[normalizedlit] : 0;
 }
 
 
 bool uksat::PartialMap::get(int var) const {
     int normalizedlit = uksat_NORMALLIT(var);
-    return normalizedlit-- && map[normalizedlit].truth ? uksat_BOOLVAL(var, map[normalizedlit].truth) : false;
+    return normalizedlit-- && values[normalizedlit] ? uksat_BOOLVAL(var, values[normalizedlit]) : false;
 }
 
 
 int uksat::PartialMap::sat(int var) const {
     int normalizedlit = uksat_NORMALLIT(var);
-    return normalizedlit-- && map[normalizedlit].truth ? uksat_NORMALVAL(var, map[normalizedlit].truth) : 0;
+    return normalizedlit-- && values[normalizedlit] ? uksat_NORMALVAL(var, values[normalizedlit]) : 0;
     
 }
 
 void uksat::PartialMap::copy(std::map<int, bool>& other) const {
-    for (int var = 1; var < getnvars(); var++)
+    for (int var = 1; var <= getnvars(); var++)
         if (isassigned(var)) other[var] = get(var);
 }
 
-
+std::size_t uksat::PartialMap::getmemory() const {
+    return memoryof(values) + memoryof(levels) + memoryof(reasons) + memoryof(watches) + arena.getmemory();
+}
@@ -0,0 +1,527 @@
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "uksat.hpp"
+
+// Smallest part of the file given to each thread
+#define uksat_PARSE_MINCHUNK (1 << 20)
+
+// Size of the blocks read from pipes (grown for longer lines)
+#define uksat_PARSE_READSIZE (1 << 20)
+
+// Most threads used by default (one per core, up to this)
+#define uksat_PARSE_MAXTHREADS 16
+
+#define uksat_PARSE_NOERROR static_cast<std::size_t>(-1)
+
+
+// Clause lines in [begin, end), parsed by one thread
+struct ParseChunk {
+    const char* begin;
+    const char* end;
+    int nvars;
+    bool extended;                  // "cnf+", with cardinality constraints
+    std::vector<int> literals;
+    std::vector<std::size_t> ends;  // End of each clause in `literals`
+    std::size_t errorat;            // Lines parsed before the first error
+
+    // Cardinality constraints, as the clauses, and the line of each one
+    // (counting both)
+    std::vector<int> cardliterals;
+    std::vector<std::size_t> cardends;
+    std::vector<int> cardbounds;
+    std::vector<std::size_t> cardlines;
+
+    // Merging
+    std::size_t nclauses;           // Clauses kept
+    std::size_t ncards;             // Cardinality constraints kept
+    std::size_t clausebase;
+    std::size_t literalbase;
+    int* outliterals;
+    std::size_t* outoffsets;
+};
+
+
+// Vars [firstvar, lastvar] counted by one thread, over all the literals
+struct CountChunk {
+    const int* begin;
+    const int* end;
+    int firstvar;
+    int lastvar;
+    int* counts;                    // By uksat_LITIDX
+};
+
+
+// Runs `fn` for every task, one thread each (the first in the caller's)
+template <typename T>
+static void runthreads(void* (*fn)(void*), std::vector<T>& tasks) {
+    std::vector<pthread_t> threads(tasks.size());
+    std::vector<bool> started(tasks.size(), false);
+
+    for (std::size_t idx = 1; idx < tasks.size(); idx++) {
+        started[idx] = pthread_create(&threads[idx], NULL, fn, &tasks[idx]) == 0;
+    }
+
+    for (std::size_t idx = 0; idx < tasks.size(); idx++) {
+        if (!started[idx]) fn(&tasks[idx]);
+    }
+
+    for (std::size_t idx = 1; idx < tasks.size(); idx++) {
+        if (started[idx]) pthread_join(threads[idx], NULL);
+    }
+}
+
+
+// Lines parsed so far, clauses and cardinality constraints
+static std::size_t countlines(const ParseChunk& chunk) {
+    return chunk.ends.size() + chunk.cardbounds.size();
+}
+
+
+// Cardinality constraints among the first `nlines` lines
+static std::size_t countcards(const ParseChunk& chunk, std::size_t nlines) {
+    return std::lower_bound(chunk.cardlines.begin(), chunk.cardlines.end(), nlines) - chunk.cardlines.begin();
+}
+
+
+// Parses the "<= k" or ">= k" ending the literals of a "cnf+" line at `pos`,
+// and moves them from the clause literals to a new cardinality constraint
+// (">= k" as at most n - k of the negated literals). Returns false if it's
+// malformed.
+static bool parsecardinality(ParseChunk& chunk, const char*& pos, const char* lineend, std::size_t clausebegin) {
+    char op = *pos++;
+    long nlits = chunk.literals.size() - clausebegin;
+    long bound = 0;
+
+    if (pos == lineend || *pos++ != '=') return false;
+    while (pos < lineend && std::isspace(*pos)) pos++;
+    if (pos == lineend || !std::isdigit(*pos)) return false;
+    while (pos < lineend && std::isdigit(*pos)) bound = std::min(bound * 10 + (*pos++ - '0'), nlits + 1);
+
+    chunk.cardlines.push_back(countlines(chunk));
+    for (std::size_t idx = clausebegin; idx < chunk.literals.size(); idx++) {
+        chunk.cardliterals.push_back(op == '>' ? -chunk.literals[idx] : chunk.literals[idx]);
+    }
+    chunk.cardends.push_back(chunk.cardliterals.size());
+    chunk.cardbounds.push_back(op == '>' ? nlits - bound : std::min(bound, nlits));
+    chunk.literals.resize(clausebegin);
+
+    return true;
+}
+
+
+// Same as the stream parser: a clause per line, zeros are skipped, and the
+// line ends at anything that isn't a number (or at the bound of a cardinality
+// constraint, in "cnf+"). Empty clauses, vars outside of the problem space and
+// problem lines are errors. Lines are appended, up to the first error.
+static void* parsechunk(void* data) {
+    ParseChunk& chunk = *static_cast<ParseChunk*>(data);
+    const char* pos = chunk.begin;
+
+    while (pos < chunk.end && chunk.errorat == uksat_PARSE_NOERROR) {
+        const char* lineend = static_cast<const char*>(std::memchr(pos, '\n', chunk.end - pos));
+        if (!lineend) lineend = chunk.end;
+        while (pos < lineend && std::isspace(*pos)) pos++;
+
+        if (pos < lineend && (*pos == '-' || std::isdigit(*pos))) {
+            std::size_t clausebegin = chunk.literals.size();
+            bool error = false;
+
+            while (pos < lineend && !error) {
+                bool negative = false;
+                long lit = 0;
+
+                while (pos < lineend && std::isspace(*pos)) pos++;
+                if (pos < lineend && *pos == '-') {
+                    negative = true;
+                    pos++;
+                }
+                if (pos == lineend || !std::isdigit(*pos)) break;
+                while (pos < lineend && std::isdigit(*pos) && lit <= chunk.nvars) lit = lit * 10 + (*pos++ - '0');
+
+                if (lit > chunk.nvars) {
+                    error = true;
+                } else if (lit) {
+                    chunk.literals.push_back(negative ? -lit : lit);
+                }
+            }
+
+            bool card = !error && chunk.extended && chunk.literals.size() > clausebegin
+                && pos < lineend && (*pos == '<' || *pos == '>');
+            if (card) error = !parsecardinality(chunk, pos, lineend, clausebegin);
+
+            if (error || (!card && chunk.literals.size() == clausebegin)) {
+                chunk.literals.resize(clausebegin);
+                chunk.errorat = countlines(chunk);
+            } else if (!card) {
+                chunk.ends.push_back(chunk.literals.size());
+            }
+
+        } else if (pos < lineend && *pos == 'p') {
+            // Two problem lines declared in the file
+            chunk.errorat = countlines(chunk);
+        }
+
+        pos = lineend + 1;
+    }
+
+    return NULL;
+}
+
+
+// Appends the first `ncards` cardinality constraints of the chunk
+static void mergecards(const ParseChunk& chunk, std::size_t ncards, std::vector<int>& cardliterals,
+        std::vector<std::size_t>& cardoffsets, std::vector<int>& cardbounds) {
+    if (ncards) {
+        cardliterals.insert(cardliterals.end(), chunk.cardliterals.begin(), chunk.cardliterals.begin() + chunk.cardends[ncards - 1]);
+    }
+    for (std::size_t idx = 0; idx < ncards; idx++) {
+        cardoffsets.push_back(cardoffsets.back() + (chunk.cardends[idx] - (idx ? chunk.cardends[idx - 1] : 0)));
+        cardbounds.push_back(chunk.cardbounds[idx]);
+    }
+}
+
+
+static void* mergechunk(void* data) {
+    ParseChunk& chunk = *static_cast<ParseChunk*>(data);
+
+    if (chunk.nclauses) {
+        std::memcpy(chunk.outliterals, &chunk.literals[0], chunk.ends[chunk.nclauses - 1] * sizeof(int));
+    }
+    for (std::size_t idx = 0; idx < chunk.nclauses; idx++) {
+        chunk.outoffsets[idx] = chunk.literalbase + chunk.ends[idx];
+    }
+
+    return NULL;
+}
+
+
+static void* countchunk(void* data) {
+    CountChunk& chunk = *static_cast<CountChunk*>(data);
+
+    for (const int* it = chunk.begin; it != chunk.end; ++it) {
+        int var = uksat_NORMALLIT(*it);
+        if (var >= chunk.firstvar && var <= chunk.lastvar) chunk.counts[uksat_LITIDX(*it)]++;
+    }
+
+    return NULL;
+}
+
+
+// Looks for the problem line in the lines of [pos, end), ignoring anything
+// else. Returns 1 if it was found (`pos` is then right after it), -1 if it's
+// malformed, and 0 if it isn't there (`pos` is then `end`). `nlines` counts
+// the clauses and, in "cnf+" (`extended`), the cardinality constraints.
+static int parseheader(const char*& pos, const char* end, int& nvars, int& nlines, bool& extended) {
+    while (pos < end) {
+        const char* lineend = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        if (!lineend) lineend = end;
+        const char* linebegin = pos;
+        while (linebegin < lineend && std::isspace(*linebegin)) linebegin++;
+        pos = lineend < end ? lineend + 1 : end;
+
+        if (linebegin < lineend && *linebegin == 'p') {
+            std::istringstream ss(std::string(linebegin, lineend));
+            std::string tname;
+            ss >> tname >> tname;
+
+            extended = tname.compare("cnf+") == 0;
+            bool valid = (tname.compare("cnf") == 0 || extended) && (ss >> nvars >> nlines) && nvars > 0 && nlines > 0;
+            return valid ? 1 : -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Parallel parsing ]
+ */
+
+
+int uksat::CnfFormula::getnthreads() const {
+    return nthreads;
+}
+
+
+void uksat::CnfFormula::setnthreads(int _nthreads) {
+    nthreads = _nthreads;
+}
+
+
+// Maps a DIMACS file and parses it in parallel: the clause lines after the
+// problem line are split in chunks (at line breaks), parsed by a thread each,
+// and copied into the arena at their offsets. Returns 1 if it was loaded, -1
+// if it's invalid, and 0 if it can't be mapped, so that the caller reads it.
+int uksat::CnfFormula::mapdimacs(const char* filename) {
+    int ret = 0;
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED) {
+            madvise(data, size, MADV_SEQUENTIAL);
+            ret = parsedimacs(static_cast<const char*>(data), size) ? 1 : -1;
+            munmap(data, size);
+        }
+    }
+
+    if (fd >= 0) close(fd);
+    return ret;
+}
+
+
+bool uksat::CnfFormula::parsedimacs(const char* data, std::size_t size) {
+    const char* pos = data;
+    const char* end = data + size;
+    int nlines = 0;
+    bool extended = false;
+
+    nvars = 0;
+    nclauses = 0;
+    literals.clear();
+    offsets.assign(1, 0);
+    frequencies.clear();
+    varorder.clear();
+    clearcardinalities();
+
+    // The problem line (clauses before it are ignored)
+    if (parseheader(pos, end, nvars, nlines, extended) <= 0 || pos >= end) {
+        nvars = 0;
+        return false;
+    }
+
+    // Splitting the clause lines
+    std::size_t nchunks = nthreads > 0 ? nthreads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0 && nchunks > uksat_PARSE_MAXTHREADS) nchunks = uksat_PARSE_MAXTHREADS;
+    nchunks = std::max<std::size_t>(1, std::min<std::size_t>(nchunks, (end - pos) / uksat_PARSE_MINCHUNK));
+
+    std::vector<ParseChunk> chunks(nchunks);
+    for (std::size_t idx = 0; idx < nchunks; idx++) {
+        ParseChunk& chunk = chunks[idx];
+        chunk.begin = idx ? chunks[idx - 1].end : pos;
+        chunk.end = idx + 1 < nchunks ? pos + (end - pos) * (idx + 1) / nchunks : end;
+        if (chunk.end < chunk.begin) chunk.end = chunk.begin;
+
+        const char* lineend = static_cast<const char*>(std::memchr(chunk.end, '\n', end - chunk.end));
+        if (chunk.end < end) chunk.end = lineend ? lineend + 1 : end;
+
+        chunk.nvars = nvars;
+        chunk.extended = extended;
+        chunk.errorat = uksat_PARSE_NOERROR;
+        chunk.literals.reserve((chunk.end - chunk.begin) / 4);
+    }
+    runthreads(parsechunk, chunks);
+
+    // Prefix sums of the lines kept in each chunk, up to `nlines`
+    bool ret = true;
+    std::size_t nkept = 0;
+    std::size_t nlits = 0;
+    for (std::vector<ParseChunk>::iterator chunk = chunks.begin(); ret && chunk != chunks.end(); ++chunk) {
+        std::size_t needed = nlines - nkept;
+        std::size_t nchunklines = std::min(needed, countlines(*chunk));
+        ret = chunk->errorat == uksat_PARSE_NOERROR || chunk->errorat >= needed;
+
+        chunk->ncards = countcards(*chunk, nchunklines);
+        chunk->nclauses = nchunklines - chunk->ncards;
+        chunk->clausebase = nclauses;
+        chunk->literalbase = nlits;
+        nkept += nchunklines;
+        nclauses += chunk->nclauses;
+        nlits += chunk->nclauses ? chunk->ends[chunk->nclauses - 1] : 0;
+    }
+
+    ret = ret && nkept == static_cast<std::size_t>(nlines);
+    if (!ret) {
+        nvars = nclauses = 0;
+        return false;
+    }
+
+    literals.resize(nlits);
+    offsets.resize(nclauses + 1);
+    for (std::vector<ParseChunk>::iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+        chunk->outliterals = nlits ? &literals[0] + chunk->literalbase : NULL;
+        chunk->outoffsets = &offsets[0] + chunk->clausebase + 1;
+    }
+    runthreads(mergechunk, chunks);
+    for (std::vector<ParseChunk>::iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+        mergecards(*chunk, chunk->ncards, cardliterals, cardoffsets, cardbounds);
+    }
+    std::vector<ParseChunk>().swap(chunks);
+
+    countfrequencies(nchunks);
+    return true;
+}
+
+
+// Counts the literal frequencies, each thread over its own range of vars,
+// and builds the var order
+void uksat::CnfFormula::countfrequencies(std::size_t nchunks) {
+    frequencies.assign(uksat_LITIDX(-nvars) + 1, 0);
+    std::vector<CountChunk> counters(std::max<std::size_t>(1, std::min<std::size_t>(nchunks, nvars)));
+
+    for (std::size_t idx = 0; idx < counters.size(); idx++) {
+        CountChunk& counter = counters[idx];
+        counter.begin = literals.empty() ? NULL : &literals[0];
+        counter.end = counter.begin + literals.size();
+        counter.firstvar = 1 + static_cast<int>(static_cast<long>(nvars) * idx / counters.size());
+        counter.lastvar = static_cast<int>(static_cast<long>(nvars) * (idx + 1) / counters.size());
+        counter.counts = &frequencies[0];
+    }
+
+    runthreads(countchunk, counters);
+    for (std::vector<int>::const_iterator it = cardliterals.begin(); it != cardliterals.end(); ++it) {
+        frequencies[uksat_LITIDX(*it)]++;
+    }
+    buildvarorder();
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Descriptors ]
+ */
+
+
+// Loads a DIMACS formula held in memory, parsed in place as a mapped file
+bool uksat::CnfFormula::openbuffer(const char* data, std::size_t size) {
+    return parsedimacs(data, size);
+}
+
+
+// Loads the formula from a file descriptor (STDIN, say), without copying it
+// first. Regular files are mapped as in openfile. Anything else (a pipe) is
+// parsed in large blocks as they are read, so that only the formula itself
+// is kept, and reading stops after its last clause. Binary formulas are read
+// whole; compressed ones aren't recognized.
+bool uksat::CnfFormula::openfd(int fd) {
+    bool ret = false;
+    bool mapped = false;
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && lseek(fd, 0, SEEK_CUR) == 0) {
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED) {
+            const char* bytes = static_cast<const char*>(data);
+            madvise(data, size, MADV_SEQUENTIAL);
+            ret = size >= 4 && std::memcmp(bytes, uksat_BINARYMAGIC, 4) == 0
+                ? openbinary(bytes, size)
+                : parsedimacs(bytes, size);
+            munmap(data, size);
+            mapped = true;
+        }
+    }
+
+    return mapped ? ret : readdimacs(fd);
+}
+
+
+bool uksat::CnfFormula::readdimacs(int fd) {
+    std::vector<char> buffer(uksat_PARSE_READSIZE);
+    std::size_t nfilled = 0;
+    bool reading = true;
+    bool checked = false;
+    bool binary = false;
+    bool header = false;
+    int nlines = 0;
+    ParseChunk chunk;
+
+    nvars = 0;
+    nclauses = 0;
+    literals.clear();
+    offsets.assign(1, 0);
+    frequencies.clear();
+    varorder.clear();
+    clearcardinalities();
+    chunk.extended = false;
+    chunk.errorat = uksat_PARSE_NOERROR;
+
+    while (reading) {
+        if (nfilled == buffer.size()) buffer.resize(2 * buffer.size());
+
+        ssize_t nread = read(fd, &buffer[0] + nfilled, buffer.size() - nfilled);
+        if (nread < 0 && errno == EINTR) continue;
+        if (nread > 0) nfilled += nread;
+        bool eof = nread <= 0;
+
+        // Nothing is parsed until the start is known not to be binary
+        if (!checked && (nfilled >= 4 || eof)) {
+            binary = nfilled >= 4 && std::memcmp(&buffer[0], uksat_BINARYMAGIC, 4) == 0;
+            checked = true;
+        }
+        if (!checked || binary) {
+            reading = !eof;
+            continue;
+        }
+
+        // Only whole lines are parsed, the rest is kept for the next block
+        const char* begin = &buffer[0];
+        const char* end = begin + nfilled;
+        const char* lastline = end;
+        if (!eof) {
+            while (lastline > begin && lastline[-1] != '\n') lastline--;
+        }
+
+        const char* pos = begin;
+        if (!header) {
+            int found = parseheader(pos, lastline, nvars, nlines, chunk.extended);
+            header = found > 0;
+            if (found < 0) break;
+
+            chunk.nvars = nvars;
+        }
+
+        if (header) {
+            chunk.begin = pos;
+            chunk.end = lastline;
+            parsechunk(&chunk);
+            reading = chunk.errorat == uksat_PARSE_NOERROR && countlines(chunk) < static_cast<std::size_t>(nlines);
+        }
+
+        nfilled = end - lastline;
+        if (nfilled) std::memmove(&buffer[0], lastline, nfilled);
+        if (eof) reading = false;
+    }
+
+    if (binary) {
+        // Copied to 8-byte aligned storage, as the sections are read in place
+        std::vector<uint64_t> data(nfilled / 8 + 1);
+        std::memcpy(&data[0], &buffer[0], nfilled);
+        std::vector<char>().swap(buffer);
+        return openbinary(reinterpret_cast<const char*>(&data[0]), nfilled);
+    }
+
+    std::size_t nkept = std::min<std::size_t>(countlines(chunk), header ? nlines : 0);
+    bool ret = header && nkept == static_cast<std::size_t>(nlines)
+        && (chunk.errorat == uksat_PARSE_NOERROR || chunk.errorat >= nkept);
+
+    if (ret) {
+        std::size_t ncards = countcards(chunk, nkept);
+        nclauses = nkept - ncards;
+        chunk.literals.resize(nclauses ? chunk.ends[nclauses - 1] : 0);
+        literals.swap(chunk.literals);
+        offsets.resize(nclauses + 1);
+        std::copy(chunk.ends.begin(), chunk.ends.begin() + nclauses, offsets.begin() + 1);
+        mergecards(chunk, ncards, cardliterals, cardoffsets, cardbounds);
+        countfrequencies(1);
+
+    } else {
+        nvars = nclauses = 0;
+    }
+
+    return ret;
+}
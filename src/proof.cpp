@@ -0,0 +1,194 @@
+
+#include <cstdio>
+#include <cstring>
+#include "uksat.hpp"
+
+// Size of the output buffer; the proof is only written in blocks this big
+#define uksat_PROOF_BUFFERSIZE (1 << 20)
+
+// Room needed for the longest literal (or tag), in both formats
+#define uksat_PROOF_MAXLITSIZE 16
+
+
+uksat::ProofWriter::ProofWriter()
+: file(NULL)
+, piped(false)
+, binary(true)
+, bufferpos(0)
+, nadded(0)
+, ndeleted(0)
+, nbytes(0)
+{
+
+}
+
+
+uksat::ProofWriter::~ProofWriter() {
+    close();
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters/Setters ]
+ */
+
+
+bool uksat::ProofWriter::isopen() const {
+    return file != NULL;
+}
+
+
+bool uksat::ProofWriter::isbinary() const {
+    return binary;
+}
+
+
+void uksat::ProofWriter::setbinary(bool _binary) {
+    binary = _binary;
+}
+
+
+std::size_t uksat::ProofWriter::getnadded() const {
+    return nadded;
+}
+
+
+std::size_t uksat::ProofWriter::getndeleted() const {
+    return ndeleted;
+}
+
+
+uint64_t uksat::ProofWriter::getnbytes() const {
+    return nbytes + bufferpos;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Output ]
+ */
+
+
+bool uksat::ProofWriter::open(const char* path) {
+    close();
+
+    if (path && std::strcmp(path, "-") == 0) {
+        file = stdout;
+
+    } else if (path && path[0] == '|') {
+        file = popen(path + 1, "w");
+        piped = file != NULL;
+
+    } else if (path) {
+        file = std::fopen(path, "wb");
+    }
+
+    if (file) {
+        // Writes are already done in large blocks
+        std::setvbuf(file, NULL, _IONBF, 0);
+        buffer.resize(uksat_PROOF_BUFFERSIZE);
+        bufferpos = 0;
+        nadded = ndeleted = 0;
+        nbytes = 0;
+    }
+
+    return file != NULL;
+}
+
+
+bool uksat::ProofWriter::close() {
+    bool ok = true;
+
+    if (file) {
+        flush();
+        if (piped) {
+            ok = pclose(file) == 0;
+        } else if (file != stdout) {
+            ok = std::fclose(file) == 0;
+        }
+        file = NULL;
+        piped = false;
+    }
+
+    return ok;
+}
+
+
+void uksat::ProofWriter::flush() {
+    if (file && bufferpos) {
+        std::fwrite(&buffer[0], 1, bufferpos, file);
+        nbytes += bufferpos;
+        bufferpos = 0;
+    }
+    if (file) std::fflush(file);
+}
+
+
+void uksat::ProofWriter::add(const int* begin, const int* end) {
+    write('a', begin, end);
+    nadded++;
+}
+
+
+void uksat::ProofWriter::add(const std::vector<int>& clause) {
+    const int* begin = clause.empty() ? NULL : &clause[0];
+    add(begin, begin + clause.size());
+}
+
+
+void uksat::ProofWriter::erase(const int* begin, const int* end) {
+    write('d', begin, end);
+    ndeleted++;
+}
+
+
+void uksat::ProofWriter::erase(const std::vector<int>& clause) {
+    const int* begin = clause.empty() ? NULL : &clause[0];
+    erase(begin, begin + clause.size());
+}
+
+
+// Binary DRAT: the tag byte, then each literal `l` as the variable-length
+// (7 bits per byte, lowest first) encoding of 2 * |l| + (l < 0), then a zero.
+// Text DRAT: "[d ]l1 l2 ... 0".
+void uksat::ProofWriter::write(char type, const int* begin, const int* end) {
+    if (!file) return;
+
+    for (const int* it = begin; it <= end; ++it) {
+        if (bufferpos + uksat_PROOF_MAXLITSIZE > buffer.size()) {
+            std::fwrite(&buffer[0], 1, bufferpos, file);
+            nbytes += bufferpos;
+            bufferpos = 0;
+        }
+
+        if (it == begin) {
+            if (binary) {
+                buffer[bufferpos++] = type;
+            } else if (type == 'd') {
+                buffer[bufferpos++] = 'd';
+                buffer[bufferpos++] = ' ';
+            }
+        }
+
+        int lit = it < end ? *it : 0;
+        if (binary) {
+            uint32_t code = 2 * static_cast<uint32_t>(uksat_NORMALLIT(lit)) + (lit < 0 ? 1 : 0);
+            while (code > 127) {
+                buffer[bufferpos++] = static_cast<char>(128 | (code & 127));
+                code >>= 7;
+            }
+            buffer[bufferpos++] = static_cast<char>(code);
+
+        } else {
+            char digits[12];
+            std::size_t ndigits = 0;
+            uint32_t val = static_cast<uint32_t>(uksat_NORMALLIT(lit));
+            do {
+                digits[ndigits++] = static_cast<char>('0' + val % 10);
+                val /= 10;
+            } while (val);
+            if (lit < 0) buffer[bufferpos++] = '-';
+            while (ndigits) buffer[bufferpos++] = digits[--ndigits];
+            buffer[bufferpos++] = it < end ? ' ' : '\n';
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include "uksat.hpp"
+
+
+uksat::PropagatingSolver::PropagatingSolver(CnfFormula& _formula)
+: Solver::Solver(_formula)
+, qhead(0)
+{
+
+}
+
+
+std::size_t uksat::PropagatingSolver::getmemory() const {
+    return Solver::getmemory() + memoryof(watches) + arena.getmemory() + memoryof(clausewatches)
+        + memoryof(values) + memoryof(trail);
+}
+
+
+void uksat::PropagatingSolver::clear() {
+    Solver::clear();
+    watches.clear();
+    arena.reset();
+    clausewatches.clear();
+    values.clear();
+    trail.clear();
+    qhead = 0;
+}
+
+
+// Unit clauses are left to the solvers, and never watched
+void uksat::PropagatingSolver::loadwatches() {
+    std::size_t nvars = formula.getnvars();
+
+    watches.clear();
+    arena.reset();
+    watches.assign(2 * nvars + 2, IndexList(IndexList::allocator_type(&arena)));
+    clausewatches.assign(formula.getnclauses(), std::make_pair(0, 0));
+    values.assign(nvars + 1, 0);
+    trail.clear();
+    qhead = 0;
+
+    for (std::size_t clauseidx = 0; clauseidx < static_cast<std::size_t>(formula.getnclauses()); clauseidx++) {
+        CnfFormula::Clause clause = formula[clauseidx];
+        if (clause.size() > 1) {
+            clausewatches[clauseidx] = std::make_pair(0, 1);
+            watches[uksat_LITIDX(clause.begin()[0])].push_back(clauseidx);
+            watches[uksat_LITIDX(clause.begin()[1])].push_back(clauseidx);
+        }
+    }
+}
+
+
+int uksat::PropagatingSolver::value(int lit) const {
+    return lit > 0 ? values[lit] : -values[-lit];
+}
+
+
+bool uksat::PropagatingSolver::assign(int lit) {
+    int truth = value(lit);
+    if (!truth) {
+        values[uksat_NORMALLIT(lit)] = lit > 0 ? 1 : -1;
+        trail.push_back(lit);
+    }
+    return truth >= 0;
+}
+
+
+// Unit propagation through watched literals, from the current queue head.
+// Watches are moved to any literal that isn't false, so they are still valid
+// once the assignment is undone.
+bool uksat::PropagatingSolver::propagate() {
+    bool ok = true;
+    while (ok && qhead < trail.size()) {
+        int falselit = -trail[qhead++];
+        IndexList& watchlist = watches[uksat_LITIDX(falselit)];
+        std::size_t kept = 0;
+        std::size_t idx = 0;
+
+        for (; ok && idx < watchlist.size(); idx++) {
+            std::size_t clauseidx = watchlist[idx];
+            CnfFormula::Clause clause = formula[clauseidx];
+            const int* lits = clause.begin();
+            std::pair<std::size_t, std::size_t>& positions = clausewatches[clauseidx];
+
+            // The false literal is left as the second watch
+            if (lits[positions.first] == falselit) std::swap(positions.first, positions.second);
+            int otherlit = lits[positions.first];
+            bool moved = false;
+
+            if (value(otherlit) <= 0) {
+                for (std::size_t pos = 0; !moved && pos < clause.size(); pos++) {
+                    if (pos != positions.first && pos != positions.second && value(lits[pos]) >= 0) {
+                        positions.second = pos;
+                        watches[uksat_LITIDX(lits[pos])].push_back(clauseidx);
+                        moved = true;
+                    }
+                }
+            }
+
+            if (!moved) {
+                watchlist[kept++] = clauseidx;
+                if (value(otherlit) < 0) ok = false;
+                else if (!value(otherlit)) assign(otherlit);
+            }
+        }
+
+        // The watches left after a conflict are kept as they are
+        for (; idx < watchlist.size(); idx++) watchlist[kept++] = watchlist[idx];
+        watchlist.resize(kept);
+    }
+    return ok;
+}
+
+
+void uksat::PropagatingSolver::undo(std::size_t trailsize) {
+    while (trail.size() > trailsize) {
+        values[uksat_NORMALLIT(trail.back())] = 0;
+        trail.pop_back();
+    }
+    qhead = trailsize;
+}
@@ -0,0 +1,563 @@
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "uksat.hpp"
+
+// Size of the blocks read from each stream
+#define uksat_SERVER_READSIZE (1 << 16)
+
+// Formulas queued for each worker before the readers wait for them
+#define uksat_SERVER_QUEUEDPERWORKER 4
+
+// Pending connections on the socket
+#define uksat_SERVER_BACKLOG 16
+
+
+// A stream being served, and its formulas still being solved
+struct uksat::Server::Stream {
+    int outfd;
+    std::size_t npending;
+    bool failed;                // The results can't be written anymore
+    pthread_mutex_t mutex;
+    pthread_cond_t done;        // No formula pending
+};
+
+
+struct uksat::Server::Job {
+    Stream* stream;
+    std::size_t number;
+    std::string text;
+};
+
+
+struct uksat::Server::Pool {
+    std::deque<Job*> jobs;
+    std::vector<pthread_t> threads;
+    std::size_t maxqueued;
+    std::size_t nserved;
+    std::set<int> connections;  // Sockets of the connections being served
+    bool stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t queued;      // A job was queued, or the workers must stop
+    pthread_cond_t taken;       // A job was taken, or a connection closed
+};
+
+
+// A connection to the socket, served in its own thread
+struct ServerConnection {
+    uksat::Server* server;
+    int fd;
+};
+
+
+// Write end of the pipe that wakes `Server::listen` up on SIGINT or SIGTERM
+static int stopfd = -1;
+
+
+static void stoplistening(int) {
+    int saved = errno;
+    char byte = 0;
+    ssize_t nwritten = write(stopfd, &byte, 1);
+    (void) nwritten;
+    errno = saved;
+}
+
+
+static bool writeall(int fd, const char* data, std::size_t size) {
+    while (size) {
+        ssize_t nwritten = write(fd, data, size);
+        if (nwritten < 0 && errno == EINTR) continue;
+        if (nwritten <= 0) return false;
+        data += nwritten;
+        size -= nwritten;
+    }
+    return true;
+}
+
+
+// The clauses (and cardinality constraints, in "cnf+") announced by a problem
+// line, or -1 if it's malformed (checked as the parser does)
+static long parseheader(const std::string& line) {
+    std::istringstream ss(line);
+    std::string tname;
+    int nvars = 0;
+    int nclauses = 0;
+
+    ss >> tname >> tname;
+    return (tname.compare("cnf") == 0 || tname.compare("cnf+") == 0)
+        && (ss >> nvars >> nclauses) && nvars > 0 && nclauses > 0 ? nclauses : -1;
+}
+
+
+uksat::Server::Server()
+: nworkers(0)
+, maxtime(0)
+, watching(true)
+, choosing(true)
+, simplifying(false)
+, maxprobes(-1)
+, pool(NULL)
+{
+
+}
+
+
+uksat::Server::~Server() {
+    stop();
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters / Setters ]
+ */
+
+
+int uksat::Server::getnworkers() const {
+    return nworkers;
+}
+
+
+void uksat::Server::setnworkers(int _nworkers) {
+    nworkers = _nworkers;
+}
+
+
+double uksat::Server::getmaxtime() const {
+    return maxtime;
+}
+
+
+void uksat::Server::setmaxtime(double secs) {
+    maxtime = secs;
+}
+
+
+bool uksat::Server::iswatching() const {
+    return watching;
+}
+
+
+void uksat::Server::setwatching(bool _watching) {
+    watching = _watching;
+}
+
+
+bool uksat::Server::ischoosing() const {
+    return choosing;
+}
+
+
+void uksat::Server::setchoosing(bool _choosing) {
+    choosing = _choosing;
+}
+
+
+bool uksat::Server::issimplifying() const {
+    return simplifying;
+}
+
+
+void uksat::Server::setsimplifying(bool _simplifying) {
+    simplifying = _simplifying;
+}
+
+
+long uksat::Server::getmaxprobes() const {
+    return maxprobes;
+}
+
+
+void uksat::Server::setmaxprobes(long nprobes) {
+    maxprobes = nprobes;
+}
+
+
+std::size_t uksat::Server::getnserved() const {
+    std::size_t nserved = 0;
+    if (pool) {
+        pthread_mutex_lock(&pool->mutex);
+        nserved = pool->nserved;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return nserved;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Workers ]
+ */
+
+
+bool uksat::Server::start() {
+    if (pool) return true;
+
+    // A client going away must not take the server down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    long nthreads = nworkers > 0 ? nworkers : sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads < 1) nthreads = 1;
+
+    pool = new Pool();
+    pool->maxqueued = uksat_SERVER_QUEUEDPERWORKER * nthreads;
+    pool->nserved = 0;
+    pool->stopping = false;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->queued, NULL);
+    pthread_cond_init(&pool->taken, NULL);
+
+    for (long idx = 0; idx < nthreads; idx++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, runworker, this) == 0) pool->threads.push_back(thread);
+    }
+
+    if (pool->threads.empty()) stop();
+    return pool != NULL;
+}
+
+
+// Waits for the queued formulas to be solved and for the workers to finish
+void uksat::Server::stop() {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->queued);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (std::vector<pthread_t>::iterator it = pool->threads.begin(); it != pool->threads.end(); ++it) {
+        pthread_join(*it, NULL);
+    }
+
+    pthread_cond_destroy(&pool->taken);
+    pthread_cond_destroy(&pool->queued);
+    pthread_mutex_destroy(&pool->mutex);
+    delete pool;
+    pool = NULL;
+}
+
+
+void* uksat::Server::runworker(void* server) {
+    static_cast<Server*>(server)->work();
+    return NULL;
+}
+
+
+// Each worker keeps its formula and its solvers, cleared for every formula
+void uksat::Server::work() {
+    CnfFormula formula;
+    SolverCache solvers(formula);
+    Simplifier simplifier(formula);
+    Job* job;
+
+    formula.setnthreads(1);
+    solvers.setmaxtime(maxtime);
+    if (maxprobes >= 0) simplifier.setmaxprobes(maxprobes);
+
+    while ((job = take()) != NULL) {
+        std::ostringstream os;
+        os << job->number << " ";
+
+        if (!formula.openbuffer(job->text.data(), job->text.size())) {
+            os << "INVALID 0";
+
+        } else {
+            if (simplifying) simplifier.simplify();
+
+            Solver& solver = solvers.get(choosesolver(formula, choosing, watching));
+            solver.clear();
+            solver.query();
+            if (solver.issatisfied() && simplifying) simplifier.extend(solver.getpartial());
+
+            os << resultname(solver) << " " << solver.getelapsedtime();
+            if (solver.issatisfied()) {
+                const std::vector<signed char>& values = solver.getpartial().values;
+                for (std::size_t idx = 0; idx < values.size(); idx++) {
+                    if (values[idx]) os << " " << (values[idx] > 0 ? 1 : -1) * static_cast<long>(idx + 1);
+                }
+                os << " 0";
+            }
+        }
+
+        os << "\n";
+        reply(job, os.str());
+    }
+}
+
+
+// Queues a formula, waiting while the workers are behind
+void uksat::Server::submit(Stream& stream, std::size_t number, const std::string& text) {
+    Job* job = new Job();
+    job->stream = &stream;
+    job->number = number;
+    job->text = text;
+
+    pthread_mutex_lock(&stream.mutex);
+    stream.npending++;
+    pthread_mutex_unlock(&stream.mutex);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->jobs.size() >= pool->maxqueued) pthread_cond_wait(&pool->taken, &pool->mutex);
+    pool->jobs.push_back(job);
+    pthread_cond_signal(&pool->queued);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+
+// The next formula to solve, or NULL once the workers must stop
+uksat::Server::Job* uksat::Server::take() {
+    Job* job = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->jobs.empty() && !pool->stopping) pthread_cond_wait(&pool->queued, &pool->mutex);
+    if (!pool->jobs.empty()) {
+        job = pool->jobs.front();
+        pool->jobs.pop_front();
+        pthread_cond_broadcast(&pool->taken);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return job;
+}
+
+
+void uksat::Server::reply(Job* job, const std::string& result) {
+    Stream& stream = *job->stream;
+
+    pthread_mutex_lock(&stream.mutex);
+    if (!stream.failed && !writeall(stream.outfd, result.data(), result.size())) stream.failed = true;
+    if (!--stream.npending) pthread_cond_broadcast(&stream.done);
+    pthread_mutex_unlock(&stream.mutex);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->nserved++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    delete job;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Serving ]
+ */
+
+
+// Splits the stream into formulas, each one from the end of the previous
+// one (comments included) up to its last clause line, as the parser counts
+// them. A problem line before the last clause ends the previous formula, and
+// so does a malformed one; the parser then rejects them.
+bool uksat::Server::serve(int infd, int outfd) {
+    if (!start()) return false;
+
+    Stream stream;
+    stream.outfd = outfd;
+    stream.npending = 0;
+    stream.failed = false;
+    pthread_mutex_init(&stream.mutex, NULL);
+    pthread_cond_init(&stream.done, NULL);
+
+    std::vector<char> block(uksat_SERVER_READSIZE);
+    std::string buffer;
+    std::size_t formulabegin = 0;
+    std::size_t scanpos = 0;
+    std::size_t number = 0;
+    long nclauses = 0;          // Clause lines left, once the problem line is read
+    bool gotheader = false;
+    bool readfailed = false;
+    bool eof = false;
+
+    bool failed = false;
+    while (!eof && !readfailed && !failed) {
+        ssize_t nread = read(infd, &block[0], block.size());
+        if (nread < 0 && errno == EINTR) continue;
+        readfailed = nread < 0;
+        eof = nread == 0;
+
+        if (nread > 0) {
+            buffer.append(&block[0], nread);
+
+        } else if (eof && scanpos < buffer.size()) {
+            buffer += '\n';
+        }
+
+        std::size_t lineend;
+        while ((lineend = buffer.find('\n', scanpos)) != std::string::npos) {
+            std::size_t linebegin = scanpos;
+            std::size_t pos = linebegin;
+            while (pos < lineend && std::isspace(buffer[pos])) pos++;
+            scanpos = lineend + 1;
+
+            if (pos < lineend && buffer[pos] == 'p') {
+                if (gotheader) {
+                    submit(stream, ++number, buffer.substr(formulabegin, linebegin - formulabegin));
+                    formulabegin = linebegin;
+                }
+
+                nclauses = parseheader(buffer.substr(pos, lineend - pos));
+                gotheader = nclauses > 0;
+                if (!gotheader) {
+                    submit(stream, ++number, buffer.substr(formulabegin, scanpos - formulabegin));
+                    formulabegin = scanpos;
+                }
+
+            } else if (gotheader && pos < lineend && (buffer[pos] == '-' || std::isdigit(buffer[pos])) && !--nclauses) {
+                submit(stream, ++number, buffer.substr(formulabegin, scanpos - formulabegin));
+                formulabegin = scanpos;
+                gotheader = false;
+            }
+        }
+
+        buffer.erase(0, formulabegin);
+        scanpos -= formulabegin;
+        formulabegin = 0;
+
+        pthread_mutex_lock(&stream.mutex);
+        failed = stream.failed;
+        pthread_mutex_unlock(&stream.mutex);
+    }
+
+    // A formula cut short by the end of the stream (anything else left is
+    // just comments)
+    if (gotheader && !failed) submit(stream, ++number, buffer);
+
+    pthread_mutex_lock(&stream.mutex);
+    while (stream.npending) pthread_cond_wait(&stream.done, &stream.mutex);
+    failed = stream.failed;
+    pthread_mutex_unlock(&stream.mutex);
+
+    pthread_cond_destroy(&stream.done);
+    pthread_mutex_destroy(&stream.mutex);
+
+    return !readfailed && !failed;
+}
+
+
+// The accept loop also polls a pipe written by the handler of SIGINT and
+// SIGTERM, so that the server stops cleanly and the socket is removed
+bool uksat::Server::listen(const char* path) {
+    struct sockaddr_un address;
+    struct stat st;
+    struct sigaction action;
+    struct sigaction oldint;
+    struct sigaction oldterm;
+    int stoppipe[2] = { -1, -1 };
+    int fd = -1;
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(address.sun_path) || !start()) return false;
+    std::strcpy(address.sun_path, path);
+
+    // A socket left by a previous server is replaced, anything else is kept
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool listening = fd >= 0
+        && bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0
+        && ::listen(fd, uksat_SERVER_BACKLOG) == 0
+        && pipe(stoppipe) == 0;
+    bool stopped = false;
+
+    if (listening) {
+        stopfd = stoppipe[1];
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = stoplistening;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, &oldint);
+        sigaction(SIGTERM, &action, &oldterm);
+    }
+
+    while (listening) {
+        struct pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = stoppipe[0];
+        fds[1].events = POLLIN;
+
+        if (poll(fds, 2, -1) < 0) {
+            listening = errno == EINTR;
+
+        } else if (fds[1].revents) {
+            stopped = true;
+            listening = false;
+
+        } else if (fds[0].revents) {
+            int connfd = accept(fd, NULL, NULL);
+
+            if (connfd < 0) {
+                listening = errno == EINTR || errno == ECONNABORTED || errno == EAGAIN;
+
+            } else {
+                ServerConnection* connection = new ServerConnection();
+                connection->server = this;
+                connection->fd = connfd;
+                pthread_t thread;
+
+                pthread_mutex_lock(&pool->mutex);
+                pool->connections.insert(connfd);
+                pthread_mutex_unlock(&pool->mutex);
+
+                if (pthread_create(&thread, NULL, runconnection, connection) == 0) {
+                    pthread_detach(thread);
+                } else {
+                    runconnection(connection);
+                }
+            }
+        }
+    }
+
+    if (stoppipe[0] >= 0) {
+        sigaction(SIGINT, &oldint, NULL);
+        sigaction(SIGTERM, &oldterm, NULL);
+        stopfd = -1;
+        close(stoppipe[0]);
+        close(stoppipe[1]);
+    }
+
+    if (fd >= 0) {
+        close(fd);
+        unlink(path);
+    }
+
+    // The connections still open are served to the end; once stopped, they
+    // read nothing else, but the formulas already read are answered
+    pthread_mutex_lock(&pool->mutex);
+    if (stopped) {
+        for (std::set<int>::const_iterator it = pool->connections.begin(); it != pool->connections.end(); ++it) {
+            shutdown(*it, SHUT_RD);
+        }
+    }
+    while (!pool->connections.empty()) pthread_cond_wait(&pool->taken, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return stopped;
+}
+
+
+void* uksat::Server::runconnection(void* data) {
+    ServerConnection* connection = static_cast<ServerConnection*>(data);
+    Server& server = *connection->server;
+
+    server.serve(connection->fd, connection->fd);
+
+    // Forgotten before closing, as the descriptor may be reused right away
+    pthread_mutex_lock(&server.pool->mutex);
+    server.pool->connections.erase(connection->fd);
+    pthread_cond_broadcast(&server.pool->taken);
+    pthread_mutex_unlock(&server.pool->mutex);
+
+    close(connection->fd);
+
+    delete connection;
+    return NULL;
+}
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include "uksat.hpp"
 
 uksat::LogType::LogType(LogTypeId _type) {
@@ -8,6 +10,13 @@ uksat::LogType::LogType(LogTypeId _type) {
 uksat::SimpleDpllSolver::SimpleDpllSolver(CnfFormula& _formula) 
 : Solver::Solver(_formula)
 , ncalls(0)
+, ndecisions(0)
+, npropagations(0)
+, nclausereads(0)
+, modelwriter(NULL)
+, nmodels(0)
+, nbatched(0)
+, ninvalidmodels(0)
 {
     
 }
@@ -23,10 +32,155 @@ int uksat::SimpleDpllSolver::currvar() {
 }
 
 
+uint64_t uksat::SimpleDpllSolver::getnmodels() const {
+    return nmodels;
+}
+
+
+uint64_t uksat::SimpleDpllSolver::getninvalidmodels() const {
+    return ninvalidmodels;
+}
+
+
+const std::vector<int>& uksat::SimpleDpllSolver::getprojection() const {
+    return projection;
+}
+
+
+void uksat::SimpleDpllSolver::setprojection(const std::vector<int>& vars) {
+    projection = vars;
+}
+
+
+uksat::ProofWriter* uksat::SimpleDpllSolver::getmodelwriter() const {
+    return modelwriter;
+}
+
+
+// The models are written as they are found; the writer must be open before
+// `enumerate()` is called, and it is not closed by the solver.
+void uksat::SimpleDpllSolver::setmodelwriter(ProofWriter* writer) {
+    modelwriter = writer;
+}
+
+
+bool uksat::SimpleDpllSolver::isprojected(int var) const {
+    std::size_t normvar = uksat_NORMALLIT(var);
+    return normvar < projected.size() && projected[normvar];
+}
+
+
+// Projected vars first, so that the others are only decided below them
+int uksat::SimpleDpllSolver::choosefreevar() {
+    if (!projection.empty()) {
+        for (std::vector<int>::const_iterator it = formula.getvarorder().begin(); it != formula.getvarorder().end(); ++it) {
+            if (isprojected(*it) && !partial.isassigned(*it)) return *it;
+        }
+    }
+    return Solver::choosefreevar();
+}
+
+
+// Counts the models of the current assignment, with every value of its free
+// vars, and writes them (counting up from all free vars false). Returns
+// false once `maxmodels` were found.
+bool uksat::SimpleDpllSolver::addmodel(uint64_t maxmodels) {
+    uint64_t nleft = maxmodels ? maxmodels - nmodels : std::numeric_limits<uint64_t>::max();
+    int nvars = formula.getnvars();
+    
+    // The assignment is batched with its free vars false, as the first model
+    // written
+    uint64_t bit = static_cast<uint64_t>(1) << nbatched;
+    for (int var = 1; var <= nvars; var++) {
+        if (partial.values[var - 1] > 0) modelbits[var] |= bit;
+    }
+    if (++nbatched == 64) checkmodels();
+    
+    modellits.clear();
+    freelits.clear();
+    for (std::size_t idx = 0; idx < (projection.empty() ? static_cast<std::size_t>(nvars) : projection.size()); idx++) {
+        int var = projection.empty() ? static_cast<int>(idx + 1) : projection[idx];
+        int value = var <= nvars ? partial.values[var - 1] : 0;
+        if (!value) freelits.push_back(modellits.size());
+        modellits.push_back(value > 0 ? var : -var);
+    }
+    
+    std::size_t nfree = freelits.size();
+    uint64_t nfound = nfree < 64 ? (static_cast<uint64_t>(1) << nfree) : std::numeric_limits<uint64_t>::max();
+    if (nfound > nleft) nfound = nleft;
+    
+    if (modelwriter) {
+        for (uint64_t bits = 0; bits < nfound; bits++) {
+            for (std::size_t idx = 0; idx < nfree && idx < 64; idx++) {
+                int& lit = modellits[freelits[idx]];
+                lit = ((bits >> idx) & 1) ? uksat_NORMALLIT(lit) : -uksat_NORMALLIT(lit);
+            }
+            modelwriter->add(modellits);
+        }
+    }
+    
+    nmodels = nfound > std::numeric_limits<uint64_t>::max() - nmodels ? std::numeric_limits<uint64_t>::max() : nmodels + nfound;
+    return !maxmodels || nmodels < maxmodels;
+}
+
+
+// Checks the batched models at once. Those rejected are checked again one
+// at a time, and counted as invalid if that check doesn't satisfy them
+// either (so that both checks have to agree).
+void uksat::SimpleDpllSolver::checkmodels() {
+    if (!nbatched) return;
+    
+    uint64_t batched = nbatched == 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << nbatched) - 1;
+    uint64_t rejected = ~formula.check(modelbits) & batched;
+    
+    if (rejected) {
+        std::vector<signed char> values(modelbits.size() - 1);
+        for (std::size_t bit = 0; bit < nbatched; bit++) {
+            if (!((rejected >> bit) & 1)) continue;
+            for (std::size_t var = 1; var < modelbits.size(); var++) {
+                values[var - 1] = ((modelbits[var] >> bit) & 1) ? 1 : -1;
+            }
+            if (formula.check(values) <= 0) ninvalidmodels++;
+        }
+    }
+    
+    std::fill(modelbits.begin(), modelbits.end(), 0);
+    nbatched = 0;
+}
+
+
 void
 uksat::SimpleDpllSolver::clear() {
     Solver::clear();
-    ncalls = 0;
+    ncalls = ndecisions = npropagations = nclausereads = 0;
+    decisions.clear();
+    propagations.clear();
+    nmodels = 0;
+    modelbits.clear();
+    nbatched = 0;
+    ninvalidmodels = 0;
+    prooflits.clear();
+    proofoffsets.clear();
+    prooflevels.clear();
+}
+
+
+void
+uksat::SimpleDpllSolver::printstats(std::ostream& os) {
+    Solver::printstats(os);
+    os << "\tsteps: " << ncalls << std::endl;
+    os << "\tdecisions: " << ndecisions << std::endl;
+    os << "\tpropagations: " << npropagations << std::endl;
+    os << "\tclausereads: " << nclausereads << std::endl;
+    os << "\tclausereadsperpropag: "
+        << (npropagations ? static_cast<double>(nclausereads) / npropagations : 0.0) << std::endl;
+}
+
+
+std::size_t
+uksat::SimpleDpllSolver::getmemory() const {
+    return Solver::getmemory() + memoryof(decisions) + memoryof(propagations)
+        + memoryof(prooflits) + memoryof(proofoffsets) + memoryof(prooflevels) + memoryof(modelbits);
 }
 
 
@@ -38,6 +192,45 @@ uksat::SimpleDpllSolver::query() {
 }
 
 
+// Enumerates the models by carrying on after each one as after a conflict:
+// the last decision not flipped yet is flipped, so that the search tree is
+// only covered once and no blocking clause is ever added. Vars left free by a
+// model are expanded. With a projection, the projected vars are decided
+// first, and the decisions on other vars are dropped after each model, so
+// that every projected model is found once. Stops after `maxmodels` (0 for
+// no limit); the solver ends satisfied if any model was found. The models are
+// checked against the formula 64 at a time as they are found.
+uint64_t
+uksat::SimpleDpllSolver::enumerate(uint64_t maxmodels) {
+    nmodels = 0;
+    ninvalidmodels = 0;
+    nbatched = 0;
+    modelbits.assign(formula.getnvars() + 1, 0);
+    start();
+    
+    projected.assign(formula.getnvars() + 1, false);
+    for (std::vector<int>::const_iterator it = projection.begin(); it != projection.end(); ++it) {
+        if (*it > 0 && *it <= formula.getnvars()) projected[*it] = true;
+    }
+    
+    while (isstarted()) {
+        while (querystep());
+        if (!issatisfied() || !addmodel(maxmodels)) break;
+        
+        if (!projection.empty()) {
+            for (std::vector<std::pair<int, bool> >::iterator it = decisions.begin(); it != decisions.end(); ++it) {
+                if (!isprojected(it->first)) it->second = true;
+            }
+        }
+        if (!backtrack()) break;
+    }
+    
+    checkmodels();
+    if (nmodels && isconflicting()) finish(1);
+    return nmodels;
+}
+
+
 bool
 uksat::SimpleDpllSolver::querystep() {
     bool keepgoing = true;
@@ -97,6 +290,19 @@ uksat::SimpleDpllSolver::propagate() {
             }
         }
         
+        for (std::size_t cardidx = 0
+                ; cardidx < static_cast<std::size_t>(formula.getncardinalities()) && truth >= 0 && !propagated
+                ; cardidx++) {
+            int cardtruth = propagatecardinality(cardidx);
+            
+            if (cardtruth <= 0) {
+                truth = cardtruth;
+                
+            } else if (cardtruth > 1) {
+                propagated = true;
+            }
+        }
+        
         uksat_LOG_(LOG_PROPAG_SAT,
             "sat = " << truth
             << ", nloops = " << count
@@ -126,6 +332,7 @@ uksat::SimpleDpllSolver::decide() {
 int
 uksat::SimpleDpllSolver::backtrack() {
     std::pair<int, bool> var = pop();
+    if (proof && isconflicting()) prove(var.first);
     if (var.first) {
         uksat_LOG_(LOG_BACK_OK, "var = " << var.first);
         // NOTE: THAT'S TRICKY! Must finish BEFORE pushing b/c watched literals!
@@ -146,8 +353,10 @@ uksat::SimpleDpllSolver::push(int var, bool decision) {
     
     if (decision) {
         decisions.push_back(std::pair<int, bool>(var, var < 0 ? true : false));
+        ndecisions++;
     } else {
         propagations.push_back(std::pair<int, int>(var, currtime()));
+        npropagations++;
     }
     partial.push(var, currvar() < 0 ? -currtime() : currtime());
 }
@@ -163,6 +372,7 @@ uksat::SimpleDpllSolver::push(const std::pair<int, bool>& decision) {
     );
     
     decisions.push_back(decision);
+    ndecisions++;
     partial.push(decision.first, decision.second < 0 ? -currtime() : currtime());
 }
 
@@ -224,8 +434,9 @@ uksat::SimpleDpllSolver::propagateclause(std::size_t clauseidx) {
     int clausesat = -1;
     int undefvar = 0;
     int nundefs = 0;
-    std::vector<int>::const_iterator iv = formula[clauseidx].begin();
-    std::vector<int>::const_iterator end = formula[clauseidx].end();
+    CnfFormula::Clause::const_iterator iv = formula[clauseidx].begin();
+    CnfFormula::Clause::const_iterator end = formula[clauseidx].end();
+    nclausereads++;
     
     while ((clausesat <= 0) && iv != end) {
         int var = *iv;
@@ -260,6 +471,70 @@ uksat::SimpleDpllSolver::propagateclause(std::size_t clauseidx) {
     return clausesat;
 }
 
+// Same as propagateclause, for a cardinality constraint: -1 with too many
+// true literals, 1 once the unassigned ones can't make too many, and 2 if
+// the unassigned ones were falsified, as the bound was reached
+int
+uksat::SimpleDpllSolver::propagatecardinality(std::size_t cardidx) {
+    CnfFormula::Clause card = formula.getcardinality(cardidx);
+    int bound = formula.getbound(cardidx);
+    int ntrue = 0;
+    int nundefs = 0;
+    nclausereads++;
+    
+    for (CnfFormula::Clause::const_iterator iv = card.begin(); iv != card.end(); ++iv) {
+        int vartruth = partial.sat(*iv);
+        if (vartruth > 0) ntrue++;
+        else if (!vartruth) nundefs++;
+    }
+    
+    int cardsat = ntrue > bound ? -1 : (ntrue + nundefs <= bound ? 1 : 0);
+    if (!cardsat && ntrue == bound) {
+        for (CnfFormula::Clause::const_iterator iv = card.begin(); iv != card.end() && !isconflicting(); ++iv) {
+            if (!partial.sat(*iv)) {
+                uksat_LOG_(LOG_PROPAG_UNIT,
+                    "cardidx = " << cardidx
+                    << ", deducedvar = " << uksat_INVERTLIT(*iv));
+                push(uksat_INVERTLIT(*iv));
+            }
+        }
+        // A push may conflict before every literal is falsified
+        cardsat = isconflicting() ? -1 : 2;
+    }
+    
+    return cardsat;
+}
+
+
+// Writes the clause that justifies flipping the last decision: the negation
+// of the decisions still standing, plus `flippedvar`. Flipped decisions are
+// left out, as they are implied by the clauses written before. With no
+// decision left to flip, the empty clause is written.
+// The clauses written for deeper levels contain the new one, and are deleted
+// from the proof, so that checkers only ever see a stack of them.
+void
+uksat::SimpleDpllSolver::prove(int flippedvar) {
+    std::size_t level = decisions.size();
+    proofclause.clear();
+    for (std::vector<std::pair<int, bool> >::const_iterator it = decisions.begin(); it != decisions.end(); ++it) {
+        if (!it->second) proofclause.push_back(-(it->first));
+    }
+    if (flippedvar) proofclause.push_back(flippedvar);
+    proof->add(proofclause);
+    if (!flippedvar) return;
+
+    while (!prooflevels.empty() && prooflevels.back() > level) {
+        proof->erase(&prooflits[0] + proofoffsets.back(), &prooflits[0] + prooflits.size());
+        prooflits.resize(proofoffsets.back());
+        proofoffsets.pop_back();
+        prooflevels.pop_back();
+    }
+    proofoffsets.push_back(prooflits.size());
+    prooflits.insert(prooflits.end(), proofclause.begin(), proofclause.end());
+    prooflevels.push_back(level);
+}
+
+
 void uksat::SimpleDpllSolver::printdecisions() {
     std::ostream& ls = log(LOG_STEP);
     ls << "CALL " << ncalls << ", TIME " << currtime() << ", NPROPAGS " << propagations.size() << ": ";
@@ -285,7 +560,7 @@ void uksat::SimpleDpllSolver::printdecisions() {
 int uksat::SimpleDpllSolver::checkclause(std::size_t clauseidx, std::pair<int, int>& watchvars) {
     int clausesat = -1;
     int undefvar = 0;
-    std::vector<int>::const_iterator iv = formula[clauseidx].begin();
+    CnfFormula::Clause::const_iterator iv = formula[clauseidx].begin();
 
     watchvars.first = 0;
     watchvars.second = 0;
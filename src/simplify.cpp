@@ -0,0 +1,494 @@
+
+#include <algorithm>
+#include "uksat.hpp"
+
+#define uksat_SIMPLIFY_MAXROUNDS 4
+
+
+uksat::Simplifier::Simplifier(CnfFormula& _formula)
+: formula(_formula)
+, maxprobes(1000)
+, maxprobesteps(10000000)
+, proof(NULL)
+, nproved(0)
+, qhead(0)
+, nprobes(0)
+, nprobesteps(0)
+, nfailed(0)
+, nequivalences(0)
+, nremoved(0)
+{
+
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters/Setters ]
+ */
+
+
+std::size_t uksat::Simplifier::getmaxprobes() const {
+    return maxprobes;
+}
+
+
+void uksat::Simplifier::setmaxprobes(std::size_t nprobes) {
+    maxprobes = nprobes;
+}
+
+
+std::size_t uksat::Simplifier::getmaxprobesteps() const {
+    return maxprobesteps;
+}
+
+
+void uksat::Simplifier::setmaxprobesteps(std::size_t nsteps) {
+    maxprobesteps = nsteps;
+}
+
+
+std::size_t uksat::Simplifier::getnprobes() const {
+    return nprobes;
+}
+
+
+std::size_t uksat::Simplifier::getnfailed() const {
+    return nfailed;
+}
+
+
+std::size_t uksat::Simplifier::getnequivalences() const {
+    return nequivalences;
+}
+
+
+std::size_t uksat::Simplifier::getnremoved() const {
+    return nremoved;
+}
+
+
+uksat::ProofWriter* uksat::Simplifier::getproof() const {
+    return proof;
+}
+
+
+// Every clause added or removed by the simplifier is written to the proof,
+// so that the solver's proof can follow it.
+void uksat::Simplifier::setproof(ProofWriter* writer) {
+    proof = writer;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Actions ]
+ */
+
+
+// Returns -1 if the formula was found to be unsatisfiable, 0 otherwise. An
+// unsatisfiable formula is replaced by a trivial contradiction.
+// Cardinality constraints aren't rewritten, so formulas with them are left as
+// they are
+int uksat::Simplifier::simplify() {
+    int sat = 0;
+    if (formula.isvalid() && !formula.getncardinalities()) {
+        load();
+        sat = reduce();
+        if (sat < 0) refute();
+        else prove();
+        store(sat);
+    }
+    return sat;
+}
+
+
+// Assigns the variables eliminated by substitution, in reverse order of
+// elimination, so that chains of substitutions resolve correctly.
+void uksat::Simplifier::extend(PartialMap& partial) const {
+    for (std::vector<std::pair<int, int> >::const_reverse_iterator it = substitutions.rbegin(); it != substitutions.rend(); ++it) {
+        int truth = partial.sat(it->second);
+        if (!truth) {
+            partial.push(-(it->second));
+            truth = -1;
+        }
+        partial.assign(it->first, truth, 0);
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Helpers ]
+ */
+
+
+int uksat::Simplifier::reduce() {
+    for (std::size_t clauseidx = 0; clauseidx < clauses.size(); clauseidx++) {
+        if (clauses[clauseidx].size() == 1 && !assign(clauses[clauseidx][0])) return -1;
+    }
+    if (!propagate() || rewrite() < 0) return -1;
+
+    for (int round = 0; round < uksat_SIMPLIFY_MAXROUNDS; round++) {
+        std::size_t ntrail = trail.size();
+        std::size_t nsubsts = substitutions.size();
+
+        if (probevars() < 0 || rewrite() < 0) return -1;
+        if (substitute() < 0 || rewrite() < 0) return -1;
+        if (ntrail == trail.size() && nsubsts == substitutions.size()) break;
+    }
+
+    return 0;
+}
+
+
+void uksat::Simplifier::load() {
+    int nvars = formula.getnvars();
+    clauses.clear();
+    clauses.reserve(formula.getnclauses());
+    for (int clauseidx = 0; clauseidx < formula.getnclauses(); clauseidx++) {
+        CnfFormula::Clause clause = formula[clauseidx];
+        clauses.push_back(std::vector<int>(clause.begin(), clause.end()));
+    }
+    values.assign(nvars + 1, 0);
+    reprs.assign(2 * (nvars + 1), 0);
+    occurs.assign(2 * (nvars + 1), std::vector<std::size_t>());
+    trail.clear();
+    substitutions.clear();
+    qhead = 0;
+    nproved = 0;
+    for (std::size_t clauseidx = 0; clauseidx < clauses.size(); clauseidx++) {
+        for (std::vector<int>::const_iterator iv = clauses[clauseidx].begin(); iv != clauses[clauseidx].end(); ++iv) {
+            occurs[uksat_LITIDX(*iv)].push_back(clauseidx);
+        }
+    }
+    nprobes = nprobesteps = nfailed = nequivalences = nremoved = 0;
+}
+
+
+// Writes back the fixed literals as unit clauses, followed by the remaining
+// clauses. Nothing is written if no clause would be left.
+void uksat::Simplifier::store(int sat) {
+    std::vector<std::vector<int> > clist;
+    if (sat < 0) {
+        clist.push_back(std::vector<int>(1, 1));
+        clist.push_back(std::vector<int>(1, -1));
+        formula.setclauses(formula.getnvars(), clist);
+        return;
+    }
+    for (std::vector<int>::const_iterator it = trail.begin(); it != trail.end(); ++it) {
+        clist.push_back(std::vector<int>(1, *it));
+    }
+    for (std::vector<std::vector<int> >::const_iterator it = clauses.begin(); it != clauses.end(); ++it) {
+        if (!it->empty()) clist.push_back(*it);
+    }
+    if (!clist.empty()) formula.setclauses(formula.getnvars(), clist);
+}
+
+
+int uksat::Simplifier::value(int lit) const {
+    return lit > 0 ? values[lit] : -values[-lit];
+}
+
+
+bool uksat::Simplifier::assign(int lit) {
+    int truth = value(lit);
+    if (!truth) {
+        values[uksat_NORMALLIT(lit)] = lit > 0 ? 1 : -1;
+        trail.push_back(lit);
+    }
+    return truth >= 0;
+}
+
+
+// Unit propagation through occurrence lists, from the current queue head.
+bool uksat::Simplifier::propagate() {
+    bool ok = true;
+    while (ok && qhead < trail.size()) {
+        int lit = trail[qhead++];
+        std::vector<std::size_t>& occurlist = occurs[uksat_LITIDX(-lit)];
+
+        for (std::vector<std::size_t>::const_iterator it = occurlist.begin(); ok && it != occurlist.end(); ++it) {
+            const std::vector<int>& clause = clauses[*it];
+            int undefvar = 0;
+            int nundefs = 0;
+            bool sat = false;
+            nprobesteps += clause.size();
+
+            for (std::vector<int>::const_iterator iv = clause.begin(); !sat && iv != clause.end(); ++iv) {
+                int truth = value(*iv);
+                if (truth > 0) sat = true;
+                else if (!truth && !nundefs++) undefvar = *iv;
+            }
+
+            if (!sat && !clause.empty()) {
+                if (!nundefs) ok = false;
+                else if (nundefs == 1) assign(undefvar);
+            }
+        }
+    }
+    return ok;
+}
+
+
+// Writes the fixed literals not yet in the proof as unit clauses. Each one
+// follows by unit propagation from the ones before it in the trail.
+void uksat::Simplifier::prove() {
+    if (!proof) return;
+    for (; nproved < trail.size(); nproved++) {
+        proof->add(&trail[nproved], &trail[nproved] + 1);
+    }
+}
+
+
+// Writes the empty clause, once a conflict was found at the top level.
+void uksat::Simplifier::refute() {
+    if (!proof) return;
+    prove();
+    proof->add(NULL, NULL);
+}
+
+
+void uksat::Simplifier::undo(std::size_t trailsize) {
+    while (trail.size() > trailsize) {
+        values[uksat_NORMALLIT(trail.back())] = 0;
+        trail.pop_back();
+    }
+    qhead = trailsize;
+}
+
+
+// Returns -1 if assuming `lit` leads to a conflict, 1 otherwise. The implied
+// literals are left on the trail; callers must undo them.
+int uksat::Simplifier::probe(int lit) {
+    nprobes++;
+    assign(lit);
+    return propagate() ? 1 : -1;
+}
+
+
+// Failed-literal probing over the most frequent variables. A literal whose
+// assumption leads to a conflict has its negation fixed; literals implied by
+// both polarities of a variable are fixed as well.
+int uksat::Simplifier::probevars() {
+    const std::vector<int>& order = formula.getvarorder();
+    std::vector<std::size_t> stamps(values.size() * 2, 0);
+    std::size_t count = 0;
+
+    for (std::vector<int>::const_iterator it = order.begin()
+            ; it != order.end() && count < maxprobes && nprobesteps < maxprobesteps
+            ; ++it) {
+        int var = *it;
+        if (value(var) || reprs[uksat_LITIDX(var)]) continue;
+        count++;
+
+        std::size_t level = trail.size();
+        std::vector<int> implied;
+
+        if (probe(var) < 0) {
+            undo(level);
+            nfailed++;
+            if (!assign(-var) || !propagate()) return -1;
+            continue;
+        }
+        for (std::size_t idx = level + 1; idx < trail.size(); idx++) {
+            stamps[uksat_LITIDX(trail[idx])] = count;
+        }
+        undo(level);
+
+        if (probe(-var) < 0) {
+            undo(level);
+            nfailed++;
+            if (!assign(var) || !propagate()) return -1;
+            continue;
+        }
+        for (std::size_t idx = level + 1; idx < trail.size(); idx++) {
+            if (stamps[uksat_LITIDX(trail[idx])] == count) implied.push_back(trail[idx]);
+        }
+        undo(level);
+
+        // Each implied literal is proved through the clause (-var, lit),
+        // which is dropped once the literal is in the proof
+        if (proof && !implied.empty()) {
+            prove();
+            for (std::vector<int>::const_iterator iv = implied.begin(); iv != implied.end(); ++iv) {
+                int helper[2] = { -var, *iv };
+                proof->add(helper, helper + 2);
+            }
+        }
+        for (std::vector<int>::const_iterator iv = implied.begin(); iv != implied.end(); ++iv) {
+            if (!assign(*iv)) return -1;
+        }
+        if (!propagate()) return -1;
+        if (proof && !implied.empty()) {
+            prove();
+            for (std::vector<int>::const_iterator iv = implied.begin(); iv != implied.end(); ++iv) {
+                int helper[2] = { -var, *iv };
+                proof->erase(helper, helper + 2);
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+// Finds the strongly connected components of the binary implication graph
+// (Tarjan's algorithm, iteratively), and maps every literal of a component to
+// the one with the lowest variable.
+int uksat::Simplifier::substitute() {
+    std::size_t nlits = values.size() * 2;
+    std::vector<std::vector<int> > edges(nlits);
+    std::vector<int> index(nlits, -1);
+    std::vector<int> lowlink(nlits, 0);
+    std::vector<int> components(nlits, 0);
+    std::vector<bool> onstack(nlits, false);
+    std::vector<int> stack;
+    std::vector<std::pair<int, std::size_t> > calls;
+    int counter = 0;
+    int ncomponents = 0;
+
+    for (std::vector<std::vector<int> >::const_iterator it = clauses.begin(); it != clauses.end(); ++it) {
+        if (it->size() == 2) {
+            edges[uksat_LITIDX(-(*it)[0])].push_back((*it)[1]);
+            edges[uksat_LITIDX(-(*it)[1])].push_back((*it)[0]);
+        }
+    }
+
+    for (int var = 1; var < static_cast<int>(values.size()); var++) {
+        for (int root = var; root != 0; root = (root > 0 ? -root : 0)) {
+            if (value(root) || index[uksat_LITIDX(root)] >= 0) continue;
+            index[uksat_LITIDX(root)] = lowlink[uksat_LITIDX(root)] = counter++;
+            stack.push_back(root);
+            onstack[uksat_LITIDX(root)] = true;
+            calls.push_back(std::pair<int, std::size_t>(root, 0));
+
+            while (!calls.empty()) {
+                int lit = calls.back().first;
+                std::size_t li = uksat_LITIDX(lit);
+
+                if (calls.back().second < edges[li].size()) {
+                    int next = edges[li][calls.back().second++];
+                    std::size_t ni = uksat_LITIDX(next);
+                    if (index[ni] < 0) {
+                        index[ni] = lowlink[ni] = counter++;
+                        stack.push_back(next);
+                        onstack[ni] = true;
+                        calls.push_back(std::pair<int, std::size_t>(next, 0));
+                    } else if (onstack[ni]) {
+                        lowlink[li] = std::min(lowlink[li], index[ni]);
+                    }
+                    continue;
+                }
+
+                calls.pop_back();
+                if (!calls.empty()) {
+                    std::size_t pi = uksat_LITIDX(calls.back().first);
+                    lowlink[pi] = std::min(lowlink[pi], lowlink[li]);
+                }
+                if (lowlink[li] != index[li]) continue;
+
+                // Pops the component, and picks its representative
+                std::size_t begin = stack.size();
+                int repr = lit;
+                ncomponents++;
+                do {
+                    int member = stack[--begin];
+                    onstack[uksat_LITIDX(member)] = false;
+                    components[uksat_LITIDX(member)] = ncomponents;
+                    if (uksat_NORMALLIT(member) < uksat_NORMALLIT(repr)) repr = member;
+                } while (stack[begin] != lit);
+
+                for (std::size_t idx = begin; idx < stack.size(); idx++) {
+                    int member = stack[idx];
+                    if (components[uksat_LITIDX(-member)] == ncomponents) {
+                        // Both polarities imply each other, so -member holds
+                        if (proof) {
+                            prove();
+                            proof->add(std::vector<int>(1, -member));
+                        }
+                        return -1;
+                    }
+                    if (member == repr || reprs[uksat_LITIDX(member)]) continue;
+                    reprs[uksat_LITIDX(member)] = repr;
+                    reprs[uksat_LITIDX(-member)] = -repr;
+                    substitutions.push_back(std::pair<int, int>(uksat_NORMALLIT(member), member > 0 ? repr : -repr));
+                    nequivalences++;
+                }
+                stack.resize(begin);
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+// Applies the substitutions and the fixed literals to all clauses, removing
+// satisfied clauses, false literals, duplicates and tautologies. New units are
+// fixed and propagated until nothing changes. Replaced clauses are only
+// deleted from the proof at the end of each pass, as the binary clauses
+// behind the substitutions may be needed to prove the new ones.
+int uksat::Simplifier::rewrite() {
+    std::vector<std::vector<int> > replaced;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        prove();
+
+        for (std::size_t clauseidx = 0; clauseidx < clauses.size(); clauseidx++) {
+            std::vector<int>& clause = clauses[clauseidx];
+            std::vector<int> newclause;
+            bool sat = false;
+            if (clause.empty()) continue;
+
+            for (std::vector<int>::const_iterator iv = clause.begin(); !sat && iv != clause.end(); ++iv) {
+                int lit = reprs[uksat_LITIDX(*iv)] ? reprs[uksat_LITIDX(*iv)] : *iv;
+                int truth = value(lit);
+                if (truth > 0 || std::find(newclause.begin(), newclause.end(), -lit) != newclause.end()) {
+                    sat = true;
+                } else if (!truth && std::find(newclause.begin(), newclause.end(), lit) == newclause.end()) {
+                    newclause.push_back(lit);
+                }
+            }
+
+            if (proof && (sat || newclause != clause) && clause.size() > 1) {
+                replaced.push_back(clause);
+            }
+
+            if (sat) {
+                clause.clear();
+                nremoved++;
+            } else if (newclause.empty()) {
+                return -1;
+            } else if (newclause.size() == 1) {
+                clause.clear();
+                nremoved++;
+                assign(newclause[0]);
+                prove();
+                changed = true;
+            } else {
+                if (proof && newclause != clause) proof->add(newclause);
+                clause.swap(newclause);
+            }
+        }
+
+        if (proof) {
+            prove();
+            for (std::vector<std::vector<int> >::const_iterator it = replaced.begin(); it != replaced.end(); ++it) {
+                proof->erase(*it);
+            }
+            replaced.clear();
+        }
+
+        for (std::vector<std::vector<std::size_t> >::iterator it = occurs.begin(); it != occurs.end(); ++it) {
+            it->clear();
+        }
+        for (std::size_t clauseidx = 0; clauseidx < clauses.size(); clauseidx++) {
+            for (std::vector<int>::const_iterator iv = clauses[clauseidx].begin(); iv != clauses[clauseidx].end(); ++iv) {
+                occurs[uksat_LITIDX(*iv)].push_back(clauseidx);
+            }
+        }
+
+        if (!propagate()) return -1;
+    }
+
+    return 0;
+}
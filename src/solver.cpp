@@ -1,18 +1,82 @@
+#include <algorithm>
 #include <ctime>
 #include <cmath>
+#include <cstdio>
 #include <limits>
 #include <iostream>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
 #include "uksat.hpp"
 
+// Calls to `inbudget()` between two measures of the memory (the first call
+// always measures it)
+#define uksat_SOLVER_MEMSTEP 256
+
+
+// CPU time of the calling thread, so that solvers running side by side in
+// one process (see `Server`) are not charged for each other. Never 0, as a
+// 0 clock means that the solver hasn't started.
+static std::clock_t solverclock() {
+    std::clock_t ticks = 0;
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        ticks = static_cast<std::clock_t>(ts.tv_sec) * CLOCKS_PER_SEC
+            + static_cast<std::clock_t>(ts.tv_nsec / (1000000000L / CLOCKS_PER_SEC));
+    }
+#endif
+    if (!ticks) ticks = std::clock();
+    return ticks ? ticks : 1;
+}
+
+
+// Resident memory of the process, from /proc (0 where there is none)
+static std::size_t residentmemory() {
+    std::size_t bytes = 0;
+    std::FILE* file = std::fopen("/proc/self/statm", "r");
+
+    if (file) {
+        unsigned long npages = 0;
+        unsigned long nresident = 0;
+        if (std::fscanf(file, "%lu %lu", &npages, &nresident) == 2) {
+            bytes = static_cast<std::size_t>(nresident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        }
+        std::fclose(file);
+    }
+
+    return bytes;
+}
+
+
+// Peak resident memory of the process (in kilobytes from Linux, in bytes
+// from macOS)
+static std::size_t peakresidentmemory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+
 uksat::Solver::Solver(CnfFormula& _formula)
     : formula(_formula)
     , clockdeltamax(0)
+    , logstream(NULL)
+    , logall(false)
+    , proof(NULL)
     , nconflicts(0)
     , clockbegin(0)
     , clockend(0)
     , timeout(false)
-    , logstream(NULL)
-    , logall(false)
+    , maxmemory(0)
+    , memory(0)
+    , peakmemory(0)
+    , nmemchecks(0)
+    , memout(false)
 {
 }
 
@@ -140,7 +204,7 @@ double uksat::Solver::getelapsedtime() const {
     return clockbegin
     ? clockend
         ? ( static_cast<double>(clockend - clockbegin) / clockspersec )
-        : ( static_cast<double>(std::clock() - clockbegin) / clockspersec)
+        : ( static_cast<double>(solverclock() - clockbegin) / clockspersec)
     : 0.0;
 }
 
@@ -164,10 +228,11 @@ uksat::Solver::setmaxtime(double secs) {
 }
 
 
+// Also false once the memory budget is exceeded
 bool
 uksat::Solver::intime() {
     bool stillintime = false;
-    if (!timeout) {
+    if (!timeout && inbudget()) {
         if (!clockdeltamax) {
             stillintime = true;
             
@@ -175,7 +240,7 @@ uksat::Solver::intime() {
             std::clock_t clockdelta = 0;
             
             if (!clockend)
-                clockdelta = std::clock() - clockbegin;
+                clockdelta = solverclock() - clockbegin;
             else
                 clockdelta = clockend - clockbegin;
             
@@ -191,6 +256,74 @@ uksat::Solver::intime() {
 }
 
 
+std::size_t
+uksat::Solver::getmaxmemory() const {
+    return maxmemory;
+}
+
+
+// In bytes, 0 for no budget. As the time limit, it's only set before the
+// solver starts.
+void
+uksat::Solver::setmaxmemory(std::size_t bytes) {
+    if (!isstarted()) maxmemory = bytes;
+}
+
+
+bool
+uksat::Solver::hasmemout() const {
+    return memout;
+}
+
+
+// Measures the memory every few calls, and returns false once it's over the
+// budget. The resident memory of the process is measured, as that's what
+// runs out; the memory tracked by the solver stands for it where it can't be
+// read.
+bool
+uksat::Solver::inbudget() {
+    if (maxmemory && !memout && !(nmemchecks++ % uksat_SOLVER_MEMSTEP)) {
+        memory = residentmemory();
+        if (!memory) memory = getmemory();
+        peakmemory = std::max(peakmemory, memory);
+
+        if (memory > maxmemory) {
+            uksat_LOG_(LOG_TIMEOUT, "memory = " << memory << ", maxmemory = " << maxmemory);
+            memout = true;
+        }
+    }
+    return !memout;
+}
+
+
+// Bytes of the formula and the assignment; each solver adds its own
+// structures
+std::size_t
+uksat::Solver::getmemory() const {
+    return formula.getmemory() + partial.getmemory();
+}
+
+
+std::size_t
+uksat::Solver::getpeakmemory() const {
+    return std::max(peakresidentmemory(), peakmemory);
+}
+
+
+uksat::ProofWriter*
+uksat::Solver::getproof() const {
+    return proof;
+}
+
+
+// The proof is written as the solver backtracks; it must be open before
+// `query()` is called, and it is not closed by the solver.
+void
+uksat::Solver::setproof(ProofWriter* writer) {
+    proof = writer;
+}
+
+
 // Actions
 
 
@@ -199,29 +332,22 @@ uksat::Solver::clear() {
     partial.setnvars(formula.getnvars());
     clockbegin = clockend = nconflicts = 0;
     timeout = false;
+    memory = nmemchecks = 0;
+    memout = false;
 }
 
 
 int 
 uksat::Solver::apply() {
-    int truth = 1;
-    for (std::size_t clauseidx = 0
-            ; clauseidx < formula.getnclauses() && truth >= 0
-            ; clauseidx++) {
-        int clausetruth = checkclause(clauseidx);
-        if (clausetruth > 1) clausetruth = 0; // Propagations doesn't happen in a simple apply
-        if (clausetruth <= 0) {
-            truth = clausetruth;
-        }
-    }
-    return truth;
+    return formula.check(partial.values);
 }
 
 
 void
 uksat::Solver::start() {
     if (formula.isvalid()) {
-        clockbegin = std::clock();
+        clockbegin = solverclock();
+        nmemchecks = 0;
         partial.setnvars(formula.getnvars());
     }
 }
@@ -229,7 +355,7 @@ uksat::Solver::start() {
 
 void
 uksat::Solver::finish(int truth) {
-    clockend = std::clock();
+    clockend = solverclock();
     result = truth;
     if (truth < 0) nconflicts++;
     uksat_LOG_(LOG_FINISH,
@@ -246,7 +372,7 @@ uksat::Solver::checkclause(std::size_t clauseidx) {
     int undefvar = 0;
     int nunsats = 0;
     
-    std::vector<int>::const_iterator iv = formula[clauseidx].begin();
+    CnfFormula::Clause::const_iterator iv = formula[clauseidx].begin();
     while ((clausesat <= 0) && iv != formula[clauseidx].end()) {
         int var = *iv;
         int vartruth = partial.sat(var);
@@ -273,6 +399,16 @@ uksat::Solver::checkclause(std::size_t clauseidx) {
 }
 
 
+void
+uksat::Solver::printstats(std::ostream& os) {
+    os << "\tconflicts: " << nconflicts << std::endl;
+    os << "\telapsedtime: " << getelapsedtime() << std::endl;
+    os << "\tmemory: " << getmemory() << std::endl;
+    os << "\tpeakmemory: " << getpeakmemory() << std::endl;
+    if (maxmemory) os << "\tmemout: " << (memout ? "true" : "false") << std::endl;
+}
+
+
 int
 uksat::Solver::choosefreevar() {
     int var = 0;
@@ -295,6 +431,13 @@ uksat::Solver::choosefreevar() {
 }
 
 
+// Whether the time or the memory ran out
+bool
+uksat::Solver::isstopped() const {
+    return timeout || memout;
+}
+
+
 std::ostream&
 uksat::Solver::log(LogTypeId ntype) {
     std::ostream* logger = logstream ? logstream : &nullstream;
@@ -0,0 +1,436 @@
+
+#include <algorithm>
+#include "uksat.hpp"
+
+// Adjacencies read by the color refinements before the search gives up
+#define uksat_SYMMETRY_DEFSTEPS (1 << 27)
+
+// Colors kept for the first path of the search (levels times nodes)
+#define uksat_SYMMETRY_MAXCOLORS (1 << 23)
+
+// Vars of each generator constrained by the lex-leader clauses; the level
+// i (from 0) takes 2^i clauses
+#define uksat_SYMMETRY_LEXDEPTH 4
+
+// Multiplier of the refinement traces (64-bit FNV prime)
+#define uksat_SYMMETRY_TRACEPRIME UINT64_C(1099511628211)
+
+
+// A node with its color and the hash of the colors of its neighbours, sorted
+// into the next colors
+struct ColorKey {
+    int color;
+    uint64_t hash;
+    int node;
+
+    bool operator<(const ColorKey& other) const {
+        return color != other.color ? color < other.color : hash < other.hash;
+    }
+};
+
+
+// Spreads a color over 64 bits (splitmix64), so that sums of them make a
+// hash of the colors of the neighbours, whatever their order
+static uint64_t mixcolor(int color) {
+    uint64_t hash = static_cast<uint64_t>(color) + UINT64_C(0x9e3779b97f4a7c15);
+    hash = (hash ^ (hash >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    hash = (hash ^ (hash >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return hash ^ (hash >> 31);
+}
+
+
+static uint64_t addtrace(uint64_t trace, uint64_t value) {
+    return (trace ^ value) * uksat_SYMMETRY_TRACEPRIME;
+}
+
+
+static int litnode(int lit) {
+    return uksat_LITIDX(lit) - 2;
+}
+
+
+static int nodelit(int node) {
+    return (node & 1) ? -(node / 2 + 1) : (node / 2 + 1);
+}
+
+
+// Sorts the literals of a clause and drops the repeated ones. Returns false
+// if the clause is a tautology.
+static bool normalize(std::vector<int>& clause) {
+    std::sort(clause.begin(), clause.end());
+    clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+    for (std::size_t idx = 0; idx < clause.size(); idx++) {
+        if (clause[idx] < 0 && std::binary_search(clause.begin(), clause.end(), -clause[idx])) return false;
+    }
+    return true;
+}
+
+
+uksat::SymmetryBreaker::SymmetryBreaker(CnfFormula& _formula)
+: formula(_formula)
+, maxsteps(uksat_SYMMETRY_DEFSTEPS)
+, nsteps(0)
+, nlitnodes(0)
+, nnodes(0)
+{
+
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters / Setters ]
+ */
+
+
+std::size_t uksat::SymmetryBreaker::getmaxsteps() const {
+    return maxsteps;
+}
+
+
+void uksat::SymmetryBreaker::setmaxsteps(std::size_t nsteps) {
+    maxsteps = nsteps;
+}
+
+
+std::size_t uksat::SymmetryBreaker::getngenerators() const {
+    return generators.size();
+}
+
+
+std::size_t uksat::SymmetryBreaker::getnadded() const {
+    return added.size();
+}
+
+
+std::size_t uksat::SymmetryBreaker::getnsteps() const {
+    return nsteps;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Symmetry breaking ]
+ */
+
+
+// Returns the number of clauses added. Cardinality constraints are not in
+// the graph, so formulas with them are left as they are.
+std::size_t uksat::SymmetryBreaker::breaksymmetries() {
+    nsteps = 0;
+    generators.clear();
+    added.clear();
+
+    if (formula.isvalid() && !formula.getncardinalities()) {
+        load();
+        findgenerators();
+        store();
+    }
+
+    // The search state may be large, and it's of no use past this point
+    std::vector<std::vector<int> >().swap(clauses);
+    std::vector<std::vector<int> >().swap(levelcolors);
+    std::vector<int>().swap(adjnodes);
+
+    return added.size();
+}
+
+
+// Builds the graph: every literal is linked to its negation and to the
+// clauses it's in. Repeated clauses are merged, as they would only swap
+// with each other.
+void uksat::SymmetryBreaker::load() {
+    nlitnodes = 2 * formula.getnvars();
+    clauses.clear();
+    clauses.reserve(formula.getnclauses());
+
+    for (int clauseidx = 0; clauseidx < formula.getnclauses(); clauseidx++) {
+        CnfFormula::Clause clause = formula[clauseidx];
+        clauses.push_back(std::vector<int>(clause.begin(), clause.end()));
+        std::sort(clauses.back().begin(), clauses.back().end());
+        clauses.back().erase(std::unique(clauses.back().begin(), clauses.back().end()), clauses.back().end());
+    }
+    std::sort(clauses.begin(), clauses.end());
+    clauses.erase(std::unique(clauses.begin(), clauses.end()), clauses.end());
+    nnodes = nlitnodes + clauses.size();
+
+    std::vector<std::size_t> degrees(nnodes, 0);
+    for (int node = 0; node < nlitnodes; node++) {
+        degrees[node]++;
+    }
+    for (std::size_t clauseidx = 0; clauseidx < clauses.size(); clauseidx++) {
+        degrees[nlitnodes + clauseidx] += clauses[clauseidx].size();
+        for (std::vector<int>::const_iterator it = clauses[clauseidx].begin(); it != clauses[clauseidx].end(); ++it) {
+            degrees[litnode(*it)]++;
+        }
+    }
+
+    adjoffsets.assign(nnodes + 1, 0);
+    for (int node = 0; node < nnodes; node++) {
+        adjoffsets[node + 1] = adjoffsets[node] + degrees[node];
+    }
+    adjnodes.resize(adjoffsets[nnodes]);
+
+    std::vector<std::size_t> ends(adjoffsets.begin(), adjoffsets.end() - 1);
+    for (int node = 0; node < nlitnodes; node++) {
+        adjnodes[ends[node]++] = node ^ 1;
+    }
+    for (std::size_t clauseidx = 0; clauseidx < clauses.size(); clauseidx++) {
+        int clausenode = nlitnodes + clauseidx;
+        for (std::vector<int>::const_iterator it = clauses[clauseidx].begin(); it != clauses[clauseidx].end(); ++it) {
+            adjnodes[ends[clausenode]++] = litnode(*it);
+            adjnodes[ends[litnode(*it)]++] = clausenode;
+        }
+    }
+}
+
+
+// Splits the colors by the colors of the neighbours, until they're stable.
+// The new colors only depend on the old ones (not on the node numbers), so
+// two colorings refine alike iff their traces are the same. Returns false
+// once out of steps.
+bool uksat::SymmetryBreaker::refine(std::vector<int>& colors, uint64_t& trace) {
+    std::vector<ColorKey> keys(nnodes);
+    int ncolors = -1;
+
+    while (nsteps <= maxsteps) {
+        for (int node = 0; node < nnodes; node++) {
+            ColorKey& key = keys[node];
+            key.color = colors[node];
+            key.hash = 0;
+            key.node = node;
+            for (std::size_t idx = adjoffsets[node]; idx < adjoffsets[node + 1]; idx++) {
+                key.hash += mixcolor(colors[adjnodes[idx]]);
+            }
+        }
+        nsteps += adjnodes.size();
+        std::sort(keys.begin(), keys.end());
+
+        int newcolors = 0;
+        std::size_t begin = 0;
+        while (begin < keys.size()) {
+            std::size_t end = begin + 1;
+            while (end < keys.size() && !(keys[begin] < keys[end])) end++;
+
+            for (std::size_t idx = begin; idx < end; idx++) {
+                colors[keys[idx].node] = newcolors;
+            }
+            trace = addtrace(addtrace(addtrace(trace, keys[begin].color), keys[begin].hash), end - begin);
+            newcolors++;
+            begin = end;
+        }
+
+        if (newcolors == ncolors) return true;
+        ncolors = newcolors;
+    }
+
+    return false;
+}
+
+
+// Gives the node a color of its own, right after the one it had
+void uksat::SymmetryBreaker::individualize(std::vector<int>& colors, int node) {
+    for (int idx = 0; idx < nnodes; idx++) {
+        colors[idx] *= 2;
+    }
+    colors[node]++;
+}
+
+
+// The smallest color of more than one literal (the first one on a tie), or
+// -1 if every literal has a color of its own
+int uksat::SymmetryBreaker::findcell(const std::vector<int>& colors) {
+    std::vector<int> sizes(nnodes, 0);
+    int cell = -1;
+
+    for (int node = 0; node < nlitnodes; node++) {
+        sizes[colors[node]]++;
+    }
+    for (int color = 0; color < nnodes; color++) {
+        if (sizes[color] > 1 && (cell < 0 || sizes[color] < sizes[cell])) cell = color;
+    }
+
+    return cell;
+}
+
+
+// Individualization-refinement. The first path individualizes the first
+// literal of the chosen cell at each level, down to a leaf where every
+// literal has a color of its own. Then, from the deepest level up, each other
+// literal of the cell is tried in place of the first one (unless it's in its
+// orbit already), and a matching path to a leaf gives a generator.
+void uksat::SymmetryBreaker::findgenerators() {
+    std::vector<int> colors(nnodes, 0);
+    uint64_t trace = 0;
+
+    levelcolors.clear();
+    levelcells.clear();
+    levelnodes.clear();
+    leveltraces.clear();
+
+    // The vars in no clause would only make trivial generators (swapping or
+    // negating them), so their literals get colors of their own
+    std::fill(colors.begin() + nlitnodes, colors.end(), 1);
+    for (int node = 0; node < nlitnodes; node++) {
+        if (adjoffsets[node + 1] - adjoffsets[node] == 1) colors[node] = 2 + node;
+    }
+    if (!refine(colors, trace)) return;
+    levelcolors.push_back(colors);
+
+    for (int cell = findcell(colors); cell >= 0; cell = findcell(colors)) {
+        if ((levelcolors.size() + 1) * static_cast<std::size_t>(nnodes) > uksat_SYMMETRY_MAXCOLORS) return;
+
+        int node = std::find(colors.begin(), colors.end(), cell) - colors.begin();
+        levelcells.push_back(cell);
+        levelnodes.push_back(node);
+        individualize(colors, node);
+        trace = 0;
+        if (!refine(colors, trace)) return;
+        leveltraces.push_back(trace);
+        levelcolors.push_back(colors);
+    }
+
+    orbits.resize(nlitnodes);
+    for (int node = 0; node < nlitnodes; node++) {
+        orbits[node] = node;
+    }
+
+    for (std::size_t level = levelcells.size(); level-- > 0 && nsteps <= maxsteps; ) {
+        int firstnode = levelnodes[level];
+
+        for (int node = 0; node < nlitnodes && nsteps <= maxsteps; node++) {
+            if (levelcolors[level][node] != levelcells[level] || findorbit(node) == findorbit(firstnode)) continue;
+
+            colors = levelcolors[level];
+            individualize(colors, node);
+            trace = 0;
+            if (refine(colors, trace) && trace == leveltraces[level]) match(colors, level + 1);
+        }
+    }
+}
+
+
+// Looks for a path from the colors (refined alike to the first path at the
+// level) to a leaf that maps the first leaf by an automorphism
+bool uksat::SymmetryBreaker::match(std::vector<int>& colors, std::size_t level) {
+    if (level == levelcells.size()) {
+        const std::vector<int>& leaf = levelcolors[level];
+        std::vector<int> nodes(nnodes, -1);
+        std::vector<int> images(nlitnodes);
+
+        for (int node = 0; node < nlitnodes; node++) {
+            nodes[colors[node]] = node;
+        }
+        for (int node = 0; node < nlitnodes; node++) {
+            images[node] = nodes[leaf[node]];
+        }
+
+        if (!isautomorphism(images)) return false;
+        addgenerator(images);
+        return true;
+    }
+
+    // The node of the first path is tried first, the likeliest to match
+    int cell = levelcells[level];
+    int firstnode = levelnodes[level];
+    std::vector<int> nextcolors;
+
+    for (int idx = -1; idx < nlitnodes && nsteps <= maxsteps; idx++) {
+        int node = idx < 0 ? firstnode : idx;
+        if (colors[node] != cell || (idx >= 0 && node == firstnode)) continue;
+
+        uint64_t trace = 0;
+        nextcolors = colors;
+        individualize(nextcolors, node);
+        if (refine(nextcolors, trace) && trace == leveltraces[level] && match(nextcolors, level + 1)) return true;
+    }
+
+    return false;
+}
+
+
+// Checks that the images of the literals keep the negations and map every
+// clause onto a clause
+bool uksat::SymmetryBreaker::isautomorphism(const std::vector<int>& images) {
+    std::vector<int> image;
+
+    for (int node = 0; node < nlitnodes; node++) {
+        if (images[node] < 0 || images[node ^ 1] != (images[node] ^ 1)) return false;
+    }
+
+    for (std::size_t clauseidx = 0; clauseidx < clauses.size(); clauseidx++) {
+        image.clear();
+        for (std::vector<int>::const_iterator it = clauses[clauseidx].begin(); it != clauses[clauseidx].end(); ++it) {
+            image.push_back(nodelit(images[litnode(*it)]));
+        }
+        std::sort(image.begin(), image.end());
+        if (!std::binary_search(clauses.begin(), clauses.end(), image)) return false;
+    }
+
+    return true;
+}
+
+
+void uksat::SymmetryBreaker::addgenerator(const std::vector<int>& images) {
+    generators.push_back(images);
+
+    for (int node = 0; node < nlitnodes; node++) {
+        int root = findorbit(node);
+        int imageroot = findorbit(images[node]);
+        if (root != imageroot) orbits[imageroot] = root;
+    }
+}
+
+
+int uksat::SymmetryBreaker::findorbit(int node) {
+    while (orbits[node] != node) {
+        orbits[node] = orbits[orbits[node]];
+        node = orbits[node];
+    }
+    return node;
+}
+
+
+// Adds the lex-leader clauses of each generator: over the vars it moves, in
+// order, x_i <= g(x_i) whenever x_j >= g(x_j) for every j < i (which, with
+// the clauses of the levels before, means x_j = g(x_j)). Only the first
+// levels are added, as they take twice as many clauses each, and a var mapped
+// to its own negation ends them (it can't be equal to its image).
+void uksat::SymmetryBreaker::store() {
+    std::vector<int> vars;
+    std::vector<int> images;
+    std::vector<int> clause;
+
+    for (std::vector<std::vector<int> >::const_iterator it = generators.begin(); it != generators.end(); ++it) {
+        vars.clear();
+        images.clear();
+
+        for (int var = 1; var <= formula.getnvars() && vars.size() < uksat_SYMMETRY_LEXDEPTH; var++) {
+            int image = nodelit((*it)[litnode(var)]);
+            if (image == var) continue;
+
+            for (unsigned int mask = 0; mask < (1u << vars.size()); mask++) {
+                clause.clear();
+                clause.push_back(-var);
+                clause.push_back(image);
+                for (std::size_t idx = 0; idx < vars.size(); idx++) {
+                    clause.push_back(((mask >> idx) & 1) ? -vars[idx] : images[idx]);
+                }
+                if (normalize(clause)) added.push_back(clause);
+            }
+
+            vars.push_back(var);
+            images.push_back(image);
+            if (image == -var) break;
+        }
+    }
+
+    if (!added.empty()) {
+        std::vector<std::vector<int> > clist;
+        clist.reserve(formula.getnclauses() + added.size());
+        for (int clauseidx = 0; clauseidx < formula.getnclauses(); clauseidx++) {
+            CnfFormula::Clause clause = formula[clauseidx];
+            clist.push_back(std::vector<int>(clause.begin(), clause.end()));
+        }
+        clist.insert(clist.end(), added.begin(), added.end());
+        formula.setclauses(formula.getnvars(), clist);
+    }
+}
@@ -0,0 +1,246 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include "uksat.hpp"
+#include "ezOptionParser.hpp"
+
+// Exit codes
+
+#define RETOK      0
+#define RETERR     1
+#define RETEARG    2
+#define RETUNSAT   20
+#define RETUNDEF   30
+
+// For the option parsing
+#define CHECKNAME    uksat_NAME "_check"
+#define EXAMPLETEXT  "Simplest usage: `" CHECKNAME " in.cnf in.drat`"
+#define OVERVIEWTEXT "Checks DRAT proofs of unsatisfiability (binary or text)."
+#define USAGETEXT     CHECKNAME " [OPTIONS] <INPUT> <PROOF>\n" \
+	"If <INPUT> or <PROOF> equals \"-\", STDIN is used.\n" \
+	"Exits with 20 if the proof refutes the formula, and 30 if it doesn't."
+
+#define VERSIONTEXT \
+	CHECKNAME " (" uksat_RELEASENAME ")"
+
+#define HELPTEXT \
+	VERSIONTEXT "\n" \
+	OVERVIEWTEXT
+
+enum EOption {
+	  NONE
+	, HELP = NONE // -h        Prints the help contents
+	, VERSION     // --version Prints version information
+	, VERBOSE     // -v        Activates verbose mode
+	, LRATFILE    // --lrat=FILE Writes the checked proof in LRAT
+};
+
+struct OptionDescriptor {
+	EOption option;
+	int numargs;
+	const char* shortname;
+	const char* longname;
+	const char* helptext;
+
+	const char* getname() const { return longname ? longname : shortname; }
+};
+
+const OptionDescriptor descriptors[] = {
+// It's EXTREMELY IMPORTANT that the order of declarations corresponds to the one in the enum EOption
+/*{ TYPE,     NUM, SHORT, LONG,        HELP }*/
+  { HELP,     0,   "-h",  "--help",    "Show this help content." }
+, { VERSION,  0,   NULL,  "--version", "Shows version information." }
+, { VERBOSE,  0,   "-v",  "--verbose", "Prints the checking statistics." }
+, { LRATFILE, 1,   NULL,  "--lrat",    "Writes the core of a verified proof to FILE, in LRAT (\"-\" for STDOUT)." }
+, { NONE,     0,   NULL,  NULL,        NULL }
+};
+
+struct ArgState {
+	ez::ezOptionParser optparser;
+	int exitcode;
+	std::string resultstr;
+	bool verbose;
+	std::string inputname;
+	std::string proofname;
+	std::string lratname;
+
+	ArgState()
+		: exitcode(RETOK)
+		, verbose(false)
+	{}
+
+	int isset(EOption option) { return optparser.isSet(descriptors[option].getname()); }
+	ez::OptionGroup* get(EOption option) { return optparser.get(descriptors[option].getname()); }
+};
+
+static void setupopts(ArgState& arg);
+static bool checkargs(ArgState& arg);
+static int evalchecker(ArgState& arg, uksat::ProofChecker& checker);
+static void printchecker(ArgState& arg, uksat::ProofChecker& checker);
+
+int main(int argc, const char** argv) {
+	ArgState arg;
+	setupopts(arg);
+	arg.optparser.parse(argc, argv);
+
+	if ( arg.isset(HELP) ) {
+		std::string txt;
+		arg.optparser.getUsage(txt);
+		std::cerr << txt;
+		return RETOK;
+
+	} else if ( arg.isset(VERSION) ) {
+		std::cerr << HELPTEXT << std::endl;
+		return RETOK;
+	}
+
+	if (checkargs(arg)) {
+		bool keepgoing = true;
+		uksat::CnfFormula cnf;
+		uksat::ProofChecker checker(cnf);
+		std::ifstream pfile;
+		std::istream* ps = &std::cin;
+
+		if (arg.proofname.compare("-") != 0) {
+			ps = &pfile;
+			pfile.open(arg.proofname.c_str(), std::ios::in | std::ios::binary);
+		}
+
+		// Loaded by name when possible, so that binary and compressed formulas work
+		bool loaded = arg.inputname.compare("-") == 0
+			? cnf.openfd(STDIN_FILENO)
+			: cnf.openfile(arg.inputname.c_str());
+
+		if (!loaded) {
+			std::cerr << "ERROR: Could not load the formula, or the formula is invalid." << std::endl;
+			keepgoing = false;
+
+		} else if (!ps->good() || !checker.openproof(*ps)) {
+			std::cerr << "ERROR: Could not read the proof, or the proof is invalid." << std::endl;
+			keepgoing = false;
+		}
+
+		if (keepgoing) {
+			checker.check();
+			evalchecker(arg, checker);
+
+			if (checker.getresult() > 0 && !arg.lratname.empty()) {
+				bool saved = arg.lratname.compare("-") == 0
+					? checker.savelrat(std::cout)
+					: checker.savelrat(arg.lratname.c_str());
+
+				if (!saved) {
+					std::cerr << "ERROR: Could not write the LRAT proof to \"" << arg.lratname << "\"." << std::endl;
+					arg.exitcode = RETERR;
+				}
+			}
+
+			printchecker(arg, checker);
+
+		} else {
+			arg.exitcode = RETERR;
+		}
+
+		if (pfile.is_open()) pfile.close();
+	}
+
+	return arg.exitcode;
+}
+
+void setupopts(ArgState& arg) {
+	arg.optparser.overview = HELPTEXT;
+	arg.optparser.syntax = USAGETEXT;
+	arg.optparser.example = EXAMPLETEXT;
+
+	const OptionDescriptor* desc = descriptors;
+	while (desc->option || (desc->shortname || desc->longname)) {
+		if (desc->shortname && desc->longname) {
+			arg.optparser.add("", false, desc->numargs, '\0', desc->helptext, desc->shortname, desc->longname);
+		} else {
+			arg.optparser.add("", false, desc->numargs, '\0', desc->helptext, desc->getname());
+		}
+		desc++;
+	}
+}
+
+bool checkargs(ArgState& arg) {
+	bool ret = true;
+	std::vector<std::string> badOptions;
+
+	if (arg.optparser.lastArgs.size() < 2) {
+		std::cerr << "ERROR: Input and proof files not given." << std::endl;
+		std::cerr << "Check `" << CHECKNAME << " -h` for help." << std::endl;
+		ret = false;
+	}
+
+	if (ret && !arg.optparser.gotExpected(badOptions)) {
+		for(std::size_t i=0; i < badOptions.size(); ++i) {
+			std::cerr << "ERROR: Wrong arguments for option " << badOptions[i] << ".\n";
+		}
+		std::cerr << "Check `" << CHECKNAME << " -h` for help." << std::endl;
+		ret = false;
+	}
+
+	if (ret) {
+		arg.verbose = arg.isset(VERBOSE);
+		arg.inputname = *arg.optparser.lastArgs[0];
+		arg.proofname = *arg.optparser.lastArgs[1];
+
+		if (arg.isset(LRATFILE)) {
+			arg.get(LRATFILE)->getString(arg.lratname);
+		}
+
+		if (arg.inputname.compare("-") == 0 && arg.proofname.compare("-") == 0) {
+			std::cerr << "ERROR: The formula and the proof can't both be read from STDIN." << std::endl;
+			ret = false;
+		}
+	}
+
+	if (!ret) {
+		arg.exitcode = RETEARG;
+	}
+
+	return ret;
+}
+
+int evalchecker(ArgState& arg, uksat::ProofChecker& checker) {
+	int ret = RETUNDEF;
+	const char* str = "FAILED";
+
+	if (checker.getresult() > 0) {
+		ret = RETUNSAT;
+		str = "VERIFIED";
+	}
+
+	arg.exitcode = ret;
+	arg.resultstr = str;
+
+	return ret;
+}
+
+void printchecker(ArgState& arg, uksat::ProofChecker& checker) {
+	if (arg.verbose) {
+		std::cerr << VERSIONTEXT << std::endl << "CHECKER:" << std::endl;
+		std::cerr << "\tinputname: '" << (arg.inputname.compare("-") == 0 ? "<stdin>" : arg.inputname.c_str()) << "'" << std::endl;
+		std::cerr << "\tproofname: '" << (arg.proofname.compare("-") == 0 ? "<stdin>" : arg.proofname.c_str()) << "'" << std::endl;
+		std::cerr << "\tlemmas: " << checker.getnlemmas() << std::endl;
+		std::cerr << "\tdeletions: " << checker.getndeleted() << std::endl;
+		std::cerr << "\tignoreddeletions: " << checker.getnignored() << std::endl;
+		std::cerr << "\tcorelemmas: " << checker.getncore() << std::endl;
+		std::cerr << "\tratlemmas: " << checker.getnrat() << std::endl;
+		std::cerr << "\trupchecks: " << checker.getnchecked() << std::endl;
+	}
+
+	if (checker.getresult() < 0) {
+		const std::vector<int>& lits = checker.getfailedlits();
+		std::cerr << "c lemma " << checker.getfailedlemma() << " failed:";
+		for (std::vector<int>::const_iterator it = lits.begin(); it != lits.end(); ++it) {
+			std::cerr << " " << *it;
+		}
+		std::cerr << " 0" << std::endl;
+	}
+
+	std::cerr << arg.resultstr << " " << checker.getelapsedtime() << " " << checker.getresult() << std::endl;
+}
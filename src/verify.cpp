@@ -0,0 +1,439 @@
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <deque>
+#include <string>
+#include <iostream>
+#include <iterator>
+#include <pthread.h>
+#include "uksat.hpp"
+
+// Size of the blocks read from the formula stream
+#define uksat_VERIFY_CHUNKSIZE (1 << 20)
+
+// Blocks the reader may get ahead of the checker
+#define uksat_VERIFY_MAXCHUNKS 4
+
+
+// Formula blocks (each ending at a line break), handed from the reader
+// thread to the checker
+struct ChunkQueue {
+    std::istream* is;
+    std::deque<std::string> chunks;
+    bool done;
+    bool stopped;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+};
+
+
+static bool pushchunk(ChunkQueue& queue, std::string& chunk) {
+    bool pushed = false;
+    pthread_mutex_lock(&queue.mutex);
+
+    while (queue.chunks.size() >= uksat_VERIFY_MAXCHUNKS && !queue.stopped)
+        pthread_cond_wait(&queue.changed, &queue.mutex);
+
+    if (!queue.stopped) {
+        queue.chunks.push_back(std::string());
+        queue.chunks.back().swap(chunk);
+        pthread_cond_broadcast(&queue.changed);
+        pushed = true;
+    }
+
+    pthread_mutex_unlock(&queue.mutex);
+    return pushed;
+}
+
+
+static bool popchunk(ChunkQueue& queue, std::string& chunk) {
+    bool popped = false;
+    pthread_mutex_lock(&queue.mutex);
+
+    while (queue.chunks.empty() && !queue.done)
+        pthread_cond_wait(&queue.changed, &queue.mutex);
+
+    if (!queue.chunks.empty()) {
+        chunk.swap(queue.chunks.front());
+        queue.chunks.pop_front();
+        pthread_cond_broadcast(&queue.changed);
+        popped = true;
+    }
+
+    pthread_mutex_unlock(&queue.mutex);
+    return popped;
+}
+
+
+static void stopchunks(ChunkQueue& queue) {
+    pthread_mutex_lock(&queue.mutex);
+    queue.stopped = true;
+    pthread_cond_broadcast(&queue.changed);
+    pthread_mutex_unlock(&queue.mutex);
+}
+
+
+static void* readchunks(void* data) {
+    ChunkQueue& queue = *static_cast<ChunkQueue*>(data);
+    std::vector<char> buf(uksat_VERIFY_CHUNKSIZE);
+    std::string carry;
+    bool reading = true;
+
+    while (reading) {
+        queue.is->read(&buf[0], buf.size());
+        std::size_t nread = static_cast<std::size_t>(queue.is->gcount());
+        std::size_t lineend = nread;
+        while (lineend && buf[lineend - 1] != '\n') lineend--;
+
+        std::string chunk;
+        chunk.reserve(carry.size() + lineend);
+        chunk.swap(carry);
+        chunk.append(&buf[0], lineend);
+        carry.assign(&buf[0] + lineend, nread - lineend);
+
+        if (!nread) {
+            // The last line may not end with a line break
+            if (!chunk.empty()) chunk.push_back('\n');
+            reading = false;
+        }
+
+        if (!chunk.empty() && !pushchunk(queue, chunk)) reading = false;
+    }
+
+    pthread_mutex_lock(&queue.mutex);
+    queue.done = true;
+    pthread_cond_broadcast(&queue.changed);
+    pthread_mutex_unlock(&queue.mutex);
+    return NULL;
+}
+
+
+uksat::Verifier::Verifier() {
+    clear();
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Getters/Setters ]
+ */
+
+
+int uksat::Verifier::getclaim() const {
+    return claim;
+}
+
+
+int uksat::Verifier::getresult() const {
+    return result;
+}
+
+
+int uksat::Verifier::getnvars() const {
+    return nvars;
+}
+
+
+int uksat::Verifier::getnclauses() const {
+    return nclauses;
+}
+
+
+std::size_t uksat::Verifier::getnchecked() const {
+    return nchecked;
+}
+
+
+long uksat::Verifier::getfailedclause() const {
+    return failedclause;
+}
+
+
+const std::vector<int>& uksat::Verifier::getfailedlits() const {
+    return failedlits;
+}
+
+
+double uksat::Verifier::getelapsedtime() const {
+    return static_cast<double>(clockend - clockbegin) / static_cast<double>(CLOCKS_PER_SEC);
+}
+
+
+bool uksat::Verifier::isvalid() const {
+    return gotheader && !malformed && (result < 0 || nchecked == static_cast<std::size_t>(nclauses));
+}
+
+
+bool uksat::Verifier::ismalformed() const {
+    return malformed;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Verification ]
+ */
+
+
+int uksat::Verifier::verify(std::istream& fml, std::istream& sol) {
+    ChunkQueue queue;
+    pthread_t reader;
+    std::string chunk;
+
+    clear();
+    clockbegin = std::clock();
+
+    // The formula is read while the solution is loaded and checked
+    queue.is = &fml;
+    queue.done = false;
+    queue.stopped = false;
+    pthread_mutex_init(&queue.mutex, NULL);
+    pthread_cond_init(&queue.changed, NULL);
+    bool threaded = pthread_create(&reader, NULL, readchunks, &queue) == 0;
+
+    opensolution(sol);
+
+    if (threaded) {
+        bool checking = true;
+        while (checking && popchunk(queue, chunk)) {
+            checking = checklines(chunk.data(), chunk.data() + chunk.size());
+        }
+        stopchunks(queue);
+        pthread_join(reader, NULL);
+
+    } else {
+        std::string formula((std::istreambuf_iterator<char>(fml)), std::istreambuf_iterator<char>());
+        formula.push_back('\n');
+        checklines(formula.data(), formula.data() + formula.size());
+    }
+
+    pthread_cond_destroy(&queue.changed);
+    pthread_mutex_destroy(&queue.mutex);
+
+    clockend = std::clock();
+    return result;
+}
+
+
+void uksat::Verifier::clear() {
+    claim = 0;
+    model.clear();
+    values.clear();
+    malformed = false;
+    nvars = 0;
+    nclauses = 0;
+    gotheader = false;
+    extended = false;
+    clause.clear();
+    result = 1;
+    nchecked = 0;
+    failedclause = -1;
+    failedlits.clear();
+    clockbegin = clockend = 0;
+}
+
+
+// Reads the "s" and "v" lines of a solution, either in the competition
+// format ("s SATISFIABLE", "v 1 -2 ... 0") or as written by
+// CnfFormula::savesolution ("s cnf <sat> <nvars> <nclauses>", "v <lit>").
+// The literals are only kept, as the vars of the formula aren't known yet.
+void uksat::Verifier::opensolution(std::istream& sol) {
+    std::string buf;
+    bool gotlines = false;
+
+    while (std::getline(sol, buf)) {
+        std::istringstream ss(buf);
+        std::string type;
+        ss >> type;
+
+        if (type == "s" || type == "v") gotlines = true;
+
+        if (type == "s") {
+            std::string status;
+            ss >> status;
+
+            if (status == "cnf") {
+                int sat = -1;
+                ss >> sat;
+                claim = sat > 0 ? 1 : (sat == 0 ? -1 : 0);
+
+            } else if (status == "SATISFIABLE") {
+                claim = 1;
+
+            } else if (status == "UNSATISFIABLE") {
+                claim = -1;
+            }
+
+        } else if (type == "v") {
+            std::string token;
+            while (ss >> token) {
+                std::istringstream ts(token);
+                long lit = 0;
+                char rest;
+                if (!(ts >> lit) || (ts >> rest) || lit < -INT_MAX || lit > INT_MAX) {
+                    malformed = true;
+                } else if (lit) {
+                    model.push_back(static_cast<int>(lit));
+                }
+            }
+        }
+    }
+
+    if (!gotlines) malformed = true;
+}
+
+
+// Sets the values of the literals read, once the header gives the vars
+void uksat::Verifier::loadsolution() {
+    values.assign(nvars + 1, 0);
+
+    for (std::vector<int>::const_iterator it = model.begin(); it != model.end() && !malformed; ++it) {
+        int var = uksat_NORMALLIT(*it);
+        if (var > nvars) {
+            malformed = true;
+        } else {
+            values[var] = *it < 0 ? -1 : 1;
+        }
+    }
+}
+
+
+// Parses and checks the formula lines in [begin, end). Clauses may span
+// lines; in "cnf+", the literals read so far followed by "<= k" or ">= k"
+// are a cardinality constraint instead. A literal out of the vars of the
+// formula makes it invalid, as a bad problem line does. Returns false once
+// nothing else needs to be checked.
+bool uksat::Verifier::checklines(const char* begin, const char* end) {
+    const char* pos = begin;
+
+    while (pos < end) {
+        const char* lineend = pos;
+        while (lineend < end && *lineend != '\n') lineend++;
+        while (pos < lineend && std::isspace(*pos)) pos++;
+
+        if (pos == lineend || *pos == 'c') {
+            // Ignores empty lines and comments
+
+        } else if (*pos == 'p') {
+            std::istringstream ss(std::string(pos, lineend));
+            std::string type;
+            ss >> type >> type;
+
+            if (!gotheader && (type == "cnf" || type == "cnf+") && (ss >> nvars >> nclauses) && nvars > 0) {
+                gotheader = true;
+                extended = type == "cnf+";
+                loadsolution();
+                if (malformed) return false;
+
+            } else {
+                // Malformed or repeated problem line
+                gotheader = false;
+                return false;
+            }
+
+        } else if (gotheader && (*pos == '-' || std::isdigit(*pos))) {
+            while (pos < lineend) {
+                bool negative = false;
+                long lit = 0;
+
+                while (pos < lineend && std::isspace(*pos)) pos++;
+                if (pos == lineend) break;
+                if (*pos == '-') {
+                    negative = true;
+                    pos++;
+                }
+                if (pos < lineend && extended && !negative && !clause.empty() && (*pos == '<' || *pos == '>')) {
+                    char op = *pos++;
+                    long bound = 0;
+                    if (pos < lineend && *pos == '=') pos++;
+                    while (pos < lineend && std::isspace(*pos)) pos++;
+                    while (pos < lineend && std::isdigit(*pos)) {
+                        bound = std::min<long>(bound * 10 + (*pos++ - '0'), clause.size() + 1);
+                    }
+
+                    if (op == '>') {
+                        for (std::vector<int>::iterator it = clause.begin(); it != clause.end(); ++it) *it = -*it;
+                        bound = static_cast<long>(clause.size()) - bound;
+                    }
+                    checkcardinality(bound);
+                    if (result < 0 || nchecked == static_cast<std::size_t>(nclauses)) return false;
+                    break;
+                }
+                if (pos == lineend || !std::isdigit(*pos)) break;
+                while (pos < lineend && std::isdigit(*pos) && lit <= nvars) lit = lit * 10 + (*pos++ - '0');
+
+                if (lit > nvars) {
+                    // Literal out of the vars of the formula
+                    gotheader = false;
+                    return false;
+
+                } else if (lit) {
+                    clause.push_back(negative ? -lit : lit);
+
+                } else {
+                    checkclause();
+                    if (result < 0 || nchecked == static_cast<std::size_t>(nclauses)) return false;
+                }
+            }
+        }
+
+        pos = lineend + 1;
+    }
+
+    return true;
+}
+
+
+void uksat::Verifier::checkclause() {
+    bool satisfied = false;
+    bool undefined = false;
+
+    for (std::vector<int>::const_iterator it = clause.begin(); it != clause.end() && !satisfied; ++it) {
+        std::size_t var = uksat_NORMALLIT(*it);
+        int val = var < values.size() ? values[var] : 0;
+
+        if (!val) {
+            undefined = true;
+        } else if (*it < 0 ? val < 0 : val > 0) {
+            satisfied = true;
+        }
+    }
+
+    if (!satisfied && (!undefined || failedclause < 0)) {
+        // The first falsified clause is reported, or else the first one
+        // left unsatisfied because of unassigned vars
+        result = undefined ? 0 : -1;
+        failedclause = nchecked;
+        failedlits = clause;
+    }
+
+    nchecked++;
+    clause.clear();
+}
+
+
+// Same as checkclause, for at most `bound` of the literals read true
+void uksat::Verifier::checkcardinality(long bound) {
+    long ntrue = 0;
+    long nundefs = 0;
+
+    for (std::vector<int>::const_iterator it = clause.begin(); it != clause.end(); ++it) {
+        std::size_t var = uksat_NORMALLIT(*it);
+        int val = var < values.size() ? values[var] : 0;
+
+        if (!val) {
+            nundefs++;
+        } else if (*it < 0 ? val < 0 : val > 0) {
+            ntrue++;
+        }
+    }
+
+    bool undefined = ntrue <= bound;
+    if (ntrue + nundefs > bound && (!undefined || failedclause < 0)) {
+        result = undefined ? 0 : -1;
+        failedclause = nchecked;
+        failedlits = clause;
+    }
+
+    nchecked++;
+    clause.clear();
+}
@@ -1,9 +1,15 @@
 
 #include "uksat.hpp"
 
+// Fewest XORs for Gauss-Jordan elimination, below that the clauses are enough
+#define uksat_WATCHED_MINXORS 8
+
 uksat::WatchedDpllSolver::WatchedDpllSolver(CnfFormula& _formula)
 : SimpleDpllSolver(_formula)
-, nsatclauses(0)
+, nbinclauses(0)
+, nblocked(0)
+, ncardprops(0)
+, nxorprops(0)
 {
     
 }
@@ -11,15 +17,67 @@ uksat::WatchedDpllSolver::WatchedDpllSolver(CnfFormula& _formula)
 
 void uksat::WatchedDpllSolver::clear() {
     SimpleDpllSolver::clear();
-    nsatclauses = 0;
+    nblocked = ncardprops = nxorprops = 0;
+}
+
+
+void uksat::WatchedDpllSolver::printstats(std::ostream& os) {
+    SimpleDpllSolver::printstats(os);
+    os << "\tbinaryclauses: " << nbinclauses << std::endl;
+    os << "\tblockedwatches: " << nblocked << std::endl;
+    os << "\tcardinalities: " << formula.getncardinalities() << std::endl;
+    os << "\tcardpropagations: " << ncardprops << std::endl;
+    os << "\txors: " << xormatrix.getnrows() << std::endl;
+    os << "\txorpivots: " << xormatrix.getnpivots() << std::endl;
+    os << "\txorpropagations: " << nxorprops << std::endl;
+}
+
+
+// The watch lists themselves are in the partial map
+std::size_t uksat::WatchedDpllSolver::getmemory() const {
+    return SimpleDpllSolver::getmemory() + memoryof(cstates) + memoryof(implications)
+        + memoryof(cardinalities) + memoryof(cardcounts) + arena.getmemory() + xormatrix.getmemory();
 }
 
 
 void uksat::WatchedDpllSolver::start() {
     SimpleDpllSolver::start();
     if (isstarted()) {
-        nsatclauses = 0;
+        nbinclauses = 0;
+        cstates.clear();
         cstates.resize(formula.getnclauses());
+        implications.clear();
+        cardinalities.clear();
+        arena.reset();
+        implications.resize(2 * (formula.getnvars() + 1), LitList(LitList::allocator_type(&arena)));
+        
+        for (std::size_t clauseidx = 0; clauseidx < static_cast<std::size_t>(formula.getnclauses()); clauseidx++) {
+            CnfFormula::Clause clause = formula[clauseidx];
+            if (clause.size() == 2) {
+                getimplications(uksat_INVERTLIT(clause[0])).push_back(clause[1]);
+                getimplications(uksat_INVERTLIT(clause[1])).push_back(clause[0]);
+                nbinclauses++;
+            }
+        }
+        
+        cardcounts.assign(formula.getncardinalities(), 0);
+        cardinalities.resize(2 * (formula.getnvars() + 1), IndexList(IndexList::allocator_type(&arena)));
+        for (std::size_t cardidx = 0; cardidx < static_cast<std::size_t>(formula.getncardinalities()); cardidx++) {
+            CnfFormula::Clause card = formula.getcardinality(cardidx);
+            for (CnfFormula::Clause::const_iterator it = card.begin(); it != card.end(); ++it) {
+                getcardinalities(*it).push_back(cardidx);
+            }
+        }
+        
+        // The XORs only add propagations to their clauses, which are kept.
+        // They can't be justified in a DRAT proof, so none when proving.
+        xormatrix.clear();
+        if (!proof) {
+            std::vector<std::vector<int> > xors;
+            std::vector<bool> parities;
+            formula.findxors(xors, parities);
+            if (xors.size() >= uksat_WATCHED_MINXORS) xormatrix.load(formula.getnvars(), xors, parities);
+        }
     }
 }
 
@@ -32,7 +90,9 @@ void uksat::WatchedDpllSolver::propagate() {
         );
         if (sat) finish(sat);
 
-    } else if (nsatclauses == formula.getnclauses()) {
+    } else if (!isconflicting() && static_cast<std::size_t>(partial.size()) == formula.getvarorder().size()) {
+        // Clause satisfaction is not tracked, the formula is satisfied once
+        // every variable is assigned without conflicts (`apply()` checks it).
         uksat_LOG_(LOG_PROPAG_SAT,
             "sat = 1"
         );
@@ -64,22 +124,42 @@ uksat::WatchedDpllSolver::push(const std::pair<int, bool>& decision) {
 }
 
 
+
+// The true literals popped are taken off the counts of their cardinality
+// constraints, as every one was counted when it was triggered, and off the
+// XOR matrix
 std::pair<int, bool>
 uksat::WatchedDpllSolver::pop(std::vector<int>& poppedvars) {
+    std::size_t npopped = poppedvars.size();
     std::pair<int, bool> invertedvar = SimpleDpllSolver::pop(poppedvars);
-    for (std::vector<int>::iterator it = poppedvars.begin(); it != poppedvars.end(); it++) {
-        int poppedvar = *it;
-        undotrigger(poppedvar);
+    
+    for (std::size_t idx = npopped; idx < poppedvars.size(); idx++) {
+        IndexList& cardidxs = getcardinalities(poppedvars[idx]);
+        for (IndexList::const_iterator it = cardidxs.begin(); it != cardidxs.end(); ++it) {
+            cardcounts[*it]--;
+        }
+        xormatrix.unassign(poppedvars[idx]);
     }
+    
     return invertedvar;
 }
 
 
+void uksat::WatchedDpllSolver::imply(int var, std::size_t clauseidx) {
+    SimpleDpllSolver::push(var);
+    partial.setreason(var, clauseidx);
+    if (intime()) trigger(var);
+}
+
+
 int uksat::WatchedDpllSolver::registerwatches() {
     int truth;
     bool propagated;
     int nclausetrue;
     std::size_t count = 0;
+    
+    // The XORs of a single var are only found by checking every row
+    triggerxors(0);
 
     do {
         truth = 1;
@@ -104,7 +184,7 @@ int uksat::WatchedDpllSolver::registerwatches() {
                     nclausetrue++;
                 }
                 
-                if (!cwatch.first || !cwatch.second) {
+                if (formula[clauseidx].size() != 2 && (!cwatch.first || !cwatch.second)) {
                     std::pair<int, int> vars = findwatchvars(clauseidx);
                     
                     if (vars.first  && (!cwatch.first || !cwatch.second)) watch(clauseidx, vars.first);
@@ -113,16 +193,36 @@ int uksat::WatchedDpllSolver::registerwatches() {
             }
         }
         
+        // Cardinality constraints are only checked here; they are counted
+        // as their literals are triggered
+        int cardtruth = 1;
+        for (std::size_t cardidx = 0
+                ; cardidx < static_cast<std::size_t>(formula.getncardinalities()) && truth >= 0 && !propagated
+                ; cardidx++) {
+            int propagatedtruth = propagatecardinality(cardidx);
+            
+            if (propagatedtruth > 1) {
+                propagated = true;
+                
+            } else if (propagatedtruth <= 0) {
+                truth = cardtruth = propagatedtruth;
+            }
+        }
+        
         uksat_LOG_(LOG_PROPAG_SAT,
             "sat = " << truth
             << ", restarts = " << count
             << ", propagated = " << propagated);
         
-        if (nclausetrue == formula.getnclauses()) {
+        if (nclausetrue == formula.getnclauses() && cardtruth > 0 && !propagated) {
             truth = 1;
         }
         count++;
     } while (propagated);
+    
+    if (isconflicting()) {
+        truth = -1;
+    }
 
     if (truth) {
         finish(truth);
@@ -134,8 +234,9 @@ int uksat::WatchedDpllSolver::registerwatches() {
 
 int uksat::WatchedDpllSolver::findwatchvar(std::size_t clauseidx, int knownvar) {
     int truevar = 0, undefvar = 0;
-    std::vector<int>::const_iterator iv = formula[clauseidx].begin();
-    std::vector<int>::const_iterator end = formula[clauseidx].end();
+    nclausereads++;
+    CnfFormula::Clause::const_iterator iv = formula[clauseidx].begin();
+    CnfFormula::Clause::const_iterator end = formula[clauseidx].end();
     
     while (iv != end && !undefvar) {
         int var = *iv;
@@ -151,8 +252,9 @@ int uksat::WatchedDpllSolver::findwatchvar(std::size_t clauseidx, int knownvar)
 
 std::pair<int, int> uksat::WatchedDpllSolver::findwatchvars(std::size_t clauseidx, int knownvar) {
     std::pair<int, int> vars(0, 0), truevars(0, 0), undefvars(0, 0);
-    std::vector<int>::const_iterator iv = formula[clauseidx].begin();
-    std::vector<int>::const_iterator end = formula[clauseidx].end();
+    nclausereads++;
+    CnfFormula::Clause::const_iterator iv = formula[clauseidx].begin();
+    CnfFormula::Clause::const_iterator end = formula[clauseidx].end();
     
     while (iv != end) {
         int var = *iv;
@@ -195,7 +297,7 @@ std::pair<int, int> uksat::WatchedDpllSolver::findwatchvars(std::size_t clauseid
 
 void uksat::WatchedDpllSolver::watch(std::size_t clauseidx, int var, int substvar) {
     std::pair<int, int>& cwatch = getclausewatches(clauseidx);
-    std::set<std::size_t>& watchset = getwatchset(var);
+    PartialMap::WatchList& watchset = getwatchset(var);
     int prevvar = 0;
     
     //uksat_LOGMARK_(LOG_WATCH_PRE);
@@ -205,7 +307,7 @@ void uksat::WatchedDpllSolver::watch(std::size_t clauseidx, int var, int substva
         partial.getwatches(cwatch.first).erase(clauseidx);
         cwatch.first = var;
         if (var)  {
-            watchset.insert(clauseidx);
+            watchset[clauseidx] = cwatch.second;
             uksat_LOG_(LOG_WATCH_DO, "Set"
                 << " clauseidx = " << clauseidx
                 << ", watchpos = 1"
@@ -229,7 +331,7 @@ void uksat::WatchedDpllSolver::watch(std::size_t clauseidx, int var, int substva
         partial.getwatches(cwatch.second).erase(clauseidx);
         cwatch.second = var;
         if (var) {
-            watchset.insert(clauseidx);
+            watchset[clauseidx] = cwatch.first;
             uksat_LOG_(LOG_WATCH_DO, "Set"
                 << " clauseidx = " << clauseidx
                 << ", watchpos = 2"
@@ -250,7 +352,7 @@ void uksat::WatchedDpllSolver::watch(std::size_t clauseidx, int var, int substva
 
     } else if (var && !cwatch.first) {
         cwatch.first = var;
-        watchset.insert(clauseidx);
+        watchset[clauseidx] = cwatch.second;
         uksat_LOG_(LOG_WATCH_DO, "New"
             << " clauseidx = " << clauseidx
             << ", watchpos = 1"
@@ -261,7 +363,8 @@ void uksat::WatchedDpllSolver::watch(std::size_t clauseidx, int var, int substva
 
     } else if (var && !cwatch.second) {
         cwatch.second = var;
-        watchset.insert(clauseidx);
+        watchset[clauseidx] = cwatch.first;
+        getwatchset(cwatch.first)[clauseidx] = var;
         uksat_LOG_(LOG_WATCH_DO, "New"
             << " clauseidx = " << clauseidx
             << ", watchpos = 2"
@@ -278,7 +381,7 @@ void uksat::WatchedDpllSolver::watch(std::size_t clauseidx, int var, int substva
         cwatch.first = var;
         
         if (var) {
-            watchset.insert(clauseidx);
+            watchset[clauseidx] = cwatch.second;
             uksat_LOG_(LOG_WATCH_DO, "Shift"
                 << " clauseidx = " << clauseidx
                 << ", var = " << var
@@ -300,37 +403,141 @@ void uksat::WatchedDpllSolver::watch(std::size_t clauseidx, int var, int substva
 }
 
 
+// Counts `var` as true in its cardinality constraints, and then falsifies
+// the unassigned literals of those that reached their bound. Returns false
+// on conflict (too many true literals).
+bool uksat::WatchedDpllSolver::triggercardinalities(int var) {
+    IndexList& cardidxs = getcardinalities(var);
+    
+    for (IndexList::const_iterator it = cardidxs.begin(); it != cardidxs.end(); ++it) {
+        cardcounts[*it]++;
+    }
+    
+    for (std::size_t idx = 0; idx < cardidxs.size() && !isconflicting(); idx++) {
+        std::size_t cardidx = cardidxs[idx];
+        int bound = formula.getbound(cardidx);
+        
+        if (cardcounts[cardidx] > bound) {
+            uksat_LOG_(LOG_PROPAG_SAT,
+                "sat = -1"
+                << ", triggervar = " << var
+                << ", cardidx = " << cardidx
+            );
+            finish(-1);
+            
+        } else if (cardcounts[cardidx] == bound) {
+            CnfFormula::Clause card = formula.getcardinality(cardidx);
+            
+            for (CnfFormula::Clause::const_iterator iv = card.begin(); iv != card.end() && !isconflicting(); ++iv) {
+                if (!partial.sat(*iv)) {
+                    uksat_LOG_(LOG_PROPAG_UNIT,
+                        "cardidx = " << cardidx
+                        << ", triggervar = " << var
+                        << ", deducedvar = " << uksat_INVERTLIT(*iv)
+                    );
+                    ncardprops++;
+                    push(uksat_INVERTLIT(*iv));
+                }
+            }
+        }
+    }
+    
+    return !isconflicting();
+}
+
+
+// Assigns `var` in the XOR matrix (or checks every row, if 0), and then
+// pushes the literals implied by its rows. Returns false on conflict.
+bool uksat::WatchedDpllSolver::triggerxors(int var) {
+    std::vector<int> implied;
+    
+    if (!(var ? xormatrix.assign(var, implied) : xormatrix.propagate(implied))) {
+        uksat_LOG_(LOG_PROPAG_SAT,
+            "sat = -1"
+            << ", triggervar = " << var
+            << ", xors = " << xormatrix.getnrows()
+        );
+        if (!isconflicting()) finish(-1);
+    }
+    
+    // The implied literals may have been assigned since, by the pushes of
+    // the ones before
+    for (std::vector<int>::const_iterator it = implied.begin(); it != implied.end() && !isconflicting(); ++it) {
+        int truth = partial.sat(*it);
+        
+        if (truth < 0) {
+            finish(-1);
+            
+        } else if (!truth) {
+            uksat_LOG_(LOG_PROPAG_UNIT,
+                "xor, triggervar = " << var
+                << ", deducedvar = " << *it
+            );
+            nxorprops++;
+            push(*it);
+        }
+    }
+    
+    return !isconflicting();
+}
+
+
 void uksat::WatchedDpllSolver::trigger(int var) {
     int invvar = uksat_INVERTLIT(var);
-    std::set<std::size_t>& watchset = getwatchset(var);
-    std::set<std::size_t>& invwatchset = getinvwatchset(var);
+    PartialMap::WatchList& watchset = getwatchset(var);
+    PartialMap::WatchList& invwatchset = getinvwatchset(var);
     std::size_t nloops = 0;
     
+    // Both take the var in before propagating, even on conflict
+    bool consistent = triggercardinalities(var);
+    consistent = triggerxors(var) && consistent;
+    if (!consistent) return;
+    
     uksat_LOG_(LOG_TRIGGER_PRE,
         "var = " << var
         << ", watchsize = " << watchset.size()
         << ", invwatchsize = " << invwatchset.size()
+        << ", nimplications = " << getimplications(var).size()
     );
     
-    // Checking the "true" watches
-    for (std::set<std::size_t>::iterator it = watchset.begin(); it != watchset.end(); it++) {
-        std::size_t clauseidx = *it;
-        if (!isvalidclausesat(clauseidx)) {
-            uksat_LOG_(LOG_PROPAG_CLAUSE,
-                " clauseidx = " << clauseidx
-                << ", clausesat = 1"
-                << ", var = " << var
-                << ", currtime = " << currtime()
+    // Binary clauses first, as they need no clause access at all
+    LitList& implied = getimplications(var);
+    for (std::size_t idx = 0; idx < implied.size(); idx++) {
+        int impliedvar = implied[idx];
+        int vartruth = partial.sat(impliedvar);
+        
+        if (vartruth < 0) {
+            uksat_LOG_(LOG_PROPAG_SAT,
+                "sat = -1"
+                << ", triggervar = " << var
+                << ", impliedvar = " << impliedvar
             );
-            setclausesat(clauseidx);
+            finish(-1);
+            return;
+            
+        } else if (!vartruth) {
+            uksat_LOG_(LOG_PROPAG_UNIT,
+                "binary = 1"
+                << ", triggervar = " << var
+                << ", deducedvar = " << impliedvar
+            );
+            push(impliedvar);
+            if (isconflicting()) return;
         }
     }
-
+    
     // Iterate over all watches on the inverted var ("false" case)
-    std::set<std::size_t>::iterator it = invwatchset.begin();
+    PartialMap::WatchList::iterator it = invwatchset.begin();
     while (it != invwatchset.end()) {
-        std::size_t clauseidx = *it;
+        std::size_t clauseidx = it->first;
         nloops++;
+        
+        // A true blocker means the clause is satisfied, no need to look at it
+        if (partial.sat(it->second) > 0) {
+            nblocked++;
+            it++;
+            continue;
+        }
 
         // Take the two var watches registered for the clause currently being notified
         std::pair<int, int>& cwatch = getclausewatches(clauseidx);
@@ -364,6 +571,14 @@ void uksat::WatchedDpllSolver::trigger(int var) {
             throw std::exception();
         }
         
+        // The other watch becomes the blocker if it is true
+        if (partial.sat(*potherpos) > 0) {
+            it->second = *potherpos;
+            nblocked++;
+            it++;
+            continue;
+        }
+        
         // Check the truth value of othervar
         int newvar = findwatchvar(clauseidx, *potherpos);
         
@@ -376,25 +591,8 @@ void uksat::WatchedDpllSolver::trigger(int var) {
                 << ", othervar = " << *potherpos
             );
             watch(clauseidx, newvar, *pwatchpos);
-            int newvartruth = partial.sat(newvar);
             
-            if (newvartruth > 0) {
-                if (!isvalidclausesat(clauseidx)) {
-                    int assigntime = partial.gettime(*potherpos);
-                    uksat_LOG_(LOG_PROPAG_CLAUSE, 
-                        " clauseidx = " << clauseidx
-                        << ", clausesat = 1"
-                        << ", triggervar = " << var
-                        << ", invtriggervar = " << invvar
-                        << ", watchidx = " << posidx
-                        << ", watchvar = " << *pwatchpos
-                        << ", assigntime = " << assigntime
-                        << ", watches = {" << cwatch.first << ", " << cwatch.second << "}"
-                    );
-                    setclausesat(clauseidx, assigntime);
-                }
-                
-            } else if (newvartruth < 0) {
+            if (partial.sat(newvar) < 0) {
                 // Something is wrong...
                 uksat_LOG_(LOG_TRIGGER_STRANGE, "NewWatchVarNotWatchable"
                     << " clauseidx = " << clauseidx
@@ -430,25 +628,8 @@ void uksat::WatchedDpllSolver::trigger(int var) {
                     << ", watchvar = " << *pwatchpos
                     << ", othervar = " << *potherpos
                 );
-                eraseclausesat(clauseidx);
                 finish(-1);
                 
-            } else if (vartruth > 0) {                
-                if (!isvalidclausesat(clauseidx)) {
-                    // Should NOT happen!
-                    int assigntime = partial.gettime(*potherpos);
-                    uksat_LOG_(LOG_TRIGGER_STRANGE, "ClauseShouldBeSat"
-                        "clauseidx = " << clauseidx
-                        << ", triggervar = " << var
-                        << ", invtriggervar = " << invvar
-                        << ", watchidx = " << posidx
-                        << ", watchvar = " << *pwatchpos
-                        << ", assigntime = " << assigntime
-                        << ", watches = {" << cwatch.first << ", " << cwatch.second << "}"
-                    );
-                    setclausesat(clauseidx, assigntime);
-                }
-                
             } else {
                 uksat_LOG_(LOG_PROPAG_UNIT,
                     "clauseidx = " << clauseidx
@@ -456,8 +637,7 @@ void uksat::WatchedDpllSolver::trigger(int var) {
                     << ", watchidx = " << posidx
                     << ", watchvar = " << *pwatchpos
                 );
-                eraseclausesat(clauseidx); // The assignment will be done on the next push
-                push(*potherpos);
+                imply(*potherpos, clauseidx);
                 it = invwatchset.begin();
                 continue;
             }
@@ -468,108 +648,26 @@ void uksat::WatchedDpllSolver::trigger(int var) {
 }
 
 
-void uksat::WatchedDpllSolver::undotrigger(int var) {
-    int invvar = uksat_INVERTLIT(var);
-    std::set<std::size_t>& watchset = getwatchset(var);
-    std::set<std::size_t>& invwatchset = getinvwatchset(var);
-    
-    uksat_LOGMARK_(LOG_TRIGGER_UNDO_PRE);
-    
-    for (std::set<std::size_t>::iterator it = watchset.begin(); it != watchset.end(); it++) {
-        std::size_t clauseidx = *it;
-        if (!isvalidtime(clauseidx)) {
-            uksat_LOG_(LOG_TRIGGER_UNDO, "WatchSet"
-                << " var = " << var
-                << ", clauseidx = " << clauseidx
-                << ", isclausesat = " << cstates[clauseidx].satisfied
-                << ", currtime = " << currtime()
-                << ", clausetime = " << cstates[clauseidx].sattime
-            );
-            eraseclausesat(clauseidx);
-        }
-    }
-    for (std::set<std::size_t>::iterator it = invwatchset.begin(); it != invwatchset.end(); it++) {
-        std::size_t clauseidx = *it;
-        if (!isvalidtime(clauseidx)) {
-            uksat_LOG_(LOG_TRIGGER_UNDO, "InvWatchSet"
-                << " var = " << var
-                << ", clauseidx = " << clauseidx
-                << ", isclausesat = " << cstates[clauseidx].satisfied
-                << ", currtime = " << currtime()
-                << ", clausetime = " << cstates[clauseidx].sattime
-            );
-            eraseclausesat(clauseidx);
-        }
-    }
-}
-
-
-bool uksat::WatchedDpllSolver::isvalidtime(int assigntime) {
-    int time = currtime();
-    int normtime = assigntime < 0 ? -assigntime : assigntime;
-    bool samesign = (normtime < 0 && time < 0) || (normtime > 0 && time > 0);
-    bool result = time >= normtime && samesign;
-    return result;
-}
-
-
-bool uksat::WatchedDpllSolver::isvalidclausesat(std::size_t clauseidx) {
-    ClauseState& cstate = cstates[clauseidx];
-    if (cstate.satisfied)
-        return isvalidtime(cstate.sattime);
-    return false;
-}
-
-
-void uksat::WatchedDpllSolver::setclausesat(std::size_t clauseidx, int time) {
-    ClauseState& cstate = cstates[clauseidx];
-    
-    if (!cstate.satisfied) {
-        cstate.satisfied = true;
-        if (!time) time = (currvar() < 0 ? -currtime() : currtime());
-        cstate.sattime = time;
-        nsatclauses++;
-        
-    } else if (time) {
-        cstate.satisfied = true;
-        cstate.sattime = time;
-    }
-    
-    uksat_LOG_(LOG_ASSIGN_CLAUSE,
-        "sat = 1"
-        << ", clauseidx = " << clauseidx
-        << ", time = " << time
-        << ", nsatclauses = " << nsatclauses
-    );
+std::pair<int, int>& uksat::WatchedDpllSolver::getclausewatches(std::size_t clauseidx) {
+    return cstates[clauseidx].watches;
 }
 
 
-void uksat::WatchedDpllSolver::eraseclausesat(std::size_t clauseidx) {
-    ClauseState& cstate = cstates[clauseidx];
-    if (cstate.satisfied) {
-        cstate.satisfied = false;
-        cstate.sattime = 0;
-        nsatclauses--;
-        uksat_LOG_(LOG_ASSIGN_CLAUSE,
-            "sat = 0"
-            << ", clauseidx = " << clauseidx
-            << ", time = " << time
-            << ", nsatclauses = " << nsatclauses
-        );
-    }
+uksat::PartialMap::WatchList& uksat::WatchedDpllSolver::getwatchset(int var) {
+    return partial.getwatches(var);
 }
 
 
-std::pair<int, int>& uksat::WatchedDpllSolver::getclausewatches(std::size_t clauseidx) {
-    return cstates[clauseidx].watches;
+uksat::PartialMap::WatchList& uksat::WatchedDpllSolver::getinvwatchset(int var) {
+    return partial.getwatches(uksat_INVERTLIT(var));
 }
 
 
-std::set<std::size_t>& uksat::WatchedDpllSolver::getwatchset(int var) {
-    return partial.getwatches(var);
+uksat::LitList& uksat::WatchedDpllSolver::getimplications(int var) {
+    return implications[uksat_LITIDX(var)];
 }
 
 
-std::set<std::size_t>& uksat::WatchedDpllSolver::getinvwatchset(int var) {
-    return partial.getwatches(uksat_INVERTLIT(var));
+uksat::IndexList& uksat::WatchedDpllSolver::getcardinalities(int var) {
+    return cardinalities[uksat_LITIDX(var)];
 }
\ No newline at end of file
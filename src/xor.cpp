@@ -0,0 +1,384 @@
+
+#include <algorithm>
+#include "uksat.hpp"
+
+// Longest XOR recovered, encoded by 2^(size - 1) clauses
+#define uksat_XOR_MAXSIZE 6
+
+
+// A clause that may encode part of an XOR: its vars (sorted, from `offset` in
+// a shared buffer), the parity of its negated literals, and which of them are
+// negated (by position in the sorted vars)
+struct XorCandidate {
+    std::size_t offset;
+    int size;
+    int parity;
+    unsigned int signs;
+};
+
+
+// Orders the candidates by vars and parity, so that the clauses of an XOR
+// are next to each other
+struct XorCandidateLess {
+    const int* vars;
+
+    XorCandidateLess(const int* _vars) : vars(_vars) {}
+
+    int compare(const XorCandidate& first, const XorCandidate& second) const {
+        if (first.size != second.size) return first.size < second.size ? -1 : 1;
+        for (int idx = 0; idx < first.size; idx++) {
+            int lhs = vars[first.offset + idx];
+            int rhs = vars[second.offset + idx];
+            if (lhs != rhs) return lhs < rhs ? -1 : 1;
+        }
+        return first.parity == second.parity ? 0 : (first.parity < second.parity ? -1 : 1);
+    }
+
+    bool operator()(const XorCandidate& first, const XorCandidate& second) const {
+        int cmp = compare(first, second);
+        return cmp ? cmp < 0 : first.signs < second.signs;
+    }
+};
+
+
+static int parity(uint64_t word) {
+    word ^= word >> 32;
+    word ^= word >> 16;
+    word ^= word >> 8;
+    word ^= word >> 4;
+    word ^= word >> 2;
+    word ^= word >> 1;
+    return static_cast<int>(word & 1);
+}
+
+
+static int lowestbit(uint64_t word) {
+    int bit = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ XOR detection ]
+ */
+
+
+// Recovers the XORs encoded in the clauses: `size` vars with 2^(size - 1)
+// clauses over them, every one negating a number of literals of the same
+// parity (each clause rules out one assignment of the wrong parity). The
+// vars of each XOR are returned with the parity they add up to.
+void uksat::CnfFormula::findxors(std::vector<std::vector<int> >& xors, std::vector<bool>& parities) const {
+    std::vector<XorCandidate> candidates;
+    std::vector<int> vars;
+
+    xors.clear();
+    parities.clear();
+
+    for (int clauseidx = 0; clauseidx < nclauses; clauseidx++) {
+        Clause clause = (*this)[clauseidx];
+        if (clause.size() < 2 || clause.size() > uksat_XOR_MAXSIZE) continue;
+
+        XorCandidate candidate;
+        candidate.offset = vars.size();
+        candidate.size = clause.size();
+        candidate.parity = 0;
+        candidate.signs = 0;
+
+        for (Clause::const_iterator it = clause.begin(); it != clause.end(); ++it) {
+            vars.push_back(uksat_NORMALLIT(*it));
+        }
+        std::sort(vars.begin() + candidate.offset, vars.end());
+
+        // Repeated vars and tautologies are left out
+        bool distinct = std::adjacent_find(vars.begin() + candidate.offset, vars.end()) == vars.end();
+        for (Clause::const_iterator it = clause.begin(); distinct && it != clause.end(); ++it) {
+            if (*it < 0) {
+                std::size_t pos = std::lower_bound(vars.begin() + candidate.offset, vars.end(), -*it) - vars.begin();
+                candidate.signs |= 1u << (pos - candidate.offset);
+                candidate.parity ^= 1;
+            }
+        }
+
+        if (distinct) {
+            candidates.push_back(candidate);
+        } else {
+            vars.resize(candidate.offset);
+        }
+    }
+
+    XorCandidateLess less(vars.empty() ? NULL : &vars[0]);
+    std::sort(candidates.begin(), candidates.end(), less);
+
+    std::size_t begin = 0;
+    while (begin < candidates.size()) {
+        const XorCandidate& first = candidates[begin];
+        std::size_t end = begin + 1;
+        std::size_t nsigns = 1;
+
+        for (; end < candidates.size() && !less.compare(first, candidates[end]); end++) {
+            if (candidates[end].signs != candidates[end - 1].signs) nsigns++;
+        }
+
+        if (nsigns == (static_cast<std::size_t>(1) << (first.size - 1))) {
+            xors.push_back(std::vector<int>(vars.begin() + first.offset, vars.begin() + first.offset + first.size));
+            parities.push_back(!first.parity);
+        }
+        begin = end;
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ * [ Gauss-Jordan elimination ]
+ */
+
+
+uksat::XorMatrix::XorMatrix()
+: nrows(0)
+, nwords(0)
+, consistent(true)
+, npivots(0)
+{
+
+}
+
+
+std::size_t uksat::XorMatrix::getnrows() const {
+    return nrows;
+}
+
+
+std::size_t uksat::XorMatrix::getncols() const {
+    return colvars.size();
+}
+
+
+std::size_t uksat::XorMatrix::getnpivots() const {
+    return npivots;
+}
+
+
+bool uksat::XorMatrix::isconsistent() const {
+    return consistent;
+}
+
+
+std::size_t uksat::XorMatrix::getmemory() const {
+    return memoryof(rows) + memoryof(basics) + memoryof(columns) + memoryof(colvars)
+        + memoryof(assigned) + memoryof(values) + memoryof(touched) + memoryof(istouched);
+}
+
+
+void uksat::XorMatrix::clear() {
+    nrows = nwords = npivots = 0;
+    consistent = true;
+    rows.clear();
+    basics.clear();
+    columns.clear();
+    colvars.clear();
+    assigned.clear();
+    values.clear();
+    touched.clear();
+    istouched.clear();
+}
+
+
+// Builds the matrix in reduced row echelon form. The rows left empty are
+// dropped, and returns false if one of them has odd parity (the XORs can't
+// be satisfied).
+bool uksat::XorMatrix::load(int nvars, const std::vector<std::vector<int> >& xors, const std::vector<bool>& parities) {
+    clear();
+    columns.assign(nvars + 1, -1);
+
+    for (std::size_t xoridx = 0; xoridx < xors.size(); xoridx++) {
+        for (std::vector<int>::const_iterator it = xors[xoridx].begin(); it != xors[xoridx].end(); ++it) {
+            if (columns[*it] < 0) {
+                columns[*it] = colvars.size();
+                colvars.push_back(*it);
+            }
+        }
+    }
+
+    int paritycol = colvars.size();
+    nwords = (paritycol >> 6) + 1;
+    rows.assign(xors.size() * nwords, 0);
+    assigned.assign(nwords, 0);
+    values.assign(nwords, 0);
+    assigned[paritycol >> 6] |= static_cast<uint64_t>(1) << (paritycol & 63);
+    values[paritycol >> 6] |= static_cast<uint64_t>(1) << (paritycol & 63);
+
+    for (std::size_t xoridx = 0; xoridx < xors.size(); xoridx++) {
+        uint64_t* row = &rows[xoridx * nwords];
+        for (std::vector<int>::const_iterator it = xors[xoridx].begin(); it != xors[xoridx].end(); ++it) {
+            int col = columns[*it];
+            row[col >> 6] ^= static_cast<uint64_t>(1) << (col & 63);
+        }
+        if (parities[xoridx]) row[paritycol >> 6] ^= static_cast<uint64_t>(1) << (paritycol & 63);
+    }
+
+    nrows = xors.size();
+    std::size_t rank = 0;
+    for (int col = 0; col < paritycol && rank < nrows; col++) {
+        std::size_t rowidx = rank;
+        while (rowidx < nrows && !hasbit(rowidx, col)) rowidx++;
+        if (rowidx == nrows) continue;
+
+        std::swap_ranges(getrow(rank), getrow(rank) + nwords, getrow(rowidx));
+        for (std::size_t otheridx = 0; otheridx < nrows; otheridx++) {
+            if (otheridx != rank && hasbit(otheridx, col)) addrow(otheridx, rank);
+        }
+        basics.push_back(col);
+        rank++;
+    }
+
+    for (std::size_t rowidx = rank; rowidx < nrows; rowidx++) {
+        if (hasbit(rowidx, paritycol)) consistent = false;
+    }
+
+    nrows = rank;
+    rows.resize(nrows * nwords);
+    istouched.assign(nrows, 0);
+
+    return consistent;
+}
+
+
+// Assigns a literal and adds the literals implied by the rows it leaves with
+// a single unassigned var. Returns false if a row got falsified.
+bool uksat::XorMatrix::assign(int lit, std::vector<int>& implied) {
+    int var = uksat_NORMALLIT(lit);
+    int col = var < static_cast<int>(columns.size()) ? columns[var] : -1;
+    bool ret = true;
+
+    if (col >= 0) {
+        uint64_t bit = static_cast<uint64_t>(1) << (col & 63);
+        assigned[col >> 6] |= bit;
+        if (lit > 0) values[col >> 6] |= bit;
+        else values[col >> 6] &= ~bit;
+
+        touched.clear();
+        for (std::size_t rowidx = 0; rowidx < nrows; rowidx++) {
+            if (hasbit(rowidx, col)) touch(rowidx);
+        }
+
+        // The rows touched by the pivots are checked as well. The basic var
+        // may also have been assigned before a backtrack, then it's moved
+        // here too.
+        for (std::size_t idx = 0; idx < touched.size(); idx++) {
+            std::size_t rowidx = touched[idx];
+            int basic = basics[rowidx];
+
+            if (assigned[basic >> 6] & (static_cast<uint64_t>(1) << (basic & 63))) {
+                int freecol = findunassigned(rowidx);
+                if (freecol >= 0) pivot(rowidx, freecol);
+            }
+        }
+
+        for (std::size_t idx = 0; idx < touched.size(); idx++) {
+            if (checkrow(touched[idx], implied) < 0) ret = false;
+            istouched[touched[idx]] = 0;
+        }
+    }
+
+    return ret;
+}
+
+
+// Checks every row, for those implied or falsified before any assignment
+bool uksat::XorMatrix::propagate(std::vector<int>& implied) {
+    bool ret = consistent;
+    for (std::size_t rowidx = 0; rowidx < nrows; rowidx++) {
+        if (checkrow(rowidx, implied) < 0) ret = false;
+    }
+    return ret;
+}
+
+
+// Nothing else is undone: any elimination of the rows stays equivalent
+void uksat::XorMatrix::unassign(int var) {
+    int normvar = uksat_NORMALLIT(var);
+    int col = normvar < static_cast<int>(columns.size()) ? columns[normvar] : -1;
+
+    if (col >= 0) {
+        assigned[col >> 6] &= ~(static_cast<uint64_t>(1) << (col & 63));
+    }
+}
+
+
+uint64_t* uksat::XorMatrix::getrow(std::size_t rowidx) {
+    return &rows[rowidx * nwords];
+}
+
+
+bool uksat::XorMatrix::hasbit(std::size_t rowidx, int col) {
+    return (getrow(rowidx)[col >> 6] >> (col & 63)) & 1;
+}
+
+
+void uksat::XorMatrix::addrow(std::size_t dstidx, std::size_t srcidx) {
+    uint64_t* dst = getrow(dstidx);
+    const uint64_t* src = getrow(srcidx);
+    for (std::size_t word = 0; word < nwords; word++) {
+        dst[word] ^= src[word];
+    }
+}
+
+
+// Makes `col` the basic var of the row, eliminating it from the other rows
+void uksat::XorMatrix::pivot(std::size_t rowidx, int col) {
+    for (std::size_t otheridx = 0; otheridx < nrows; otheridx++) {
+        if (otheridx != rowidx && hasbit(otheridx, col)) {
+            addrow(otheridx, rowidx);
+            touch(otheridx);
+        }
+    }
+    basics[rowidx] = col;
+    npivots++;
+}
+
+
+int uksat::XorMatrix::findunassigned(std::size_t rowidx) {
+    const uint64_t* row = getrow(rowidx);
+    for (std::size_t word = 0; word < nwords; word++) {
+        uint64_t free = row[word] & ~assigned[word];
+        if (free) return (word << 6) + lowestbit(free);
+    }
+    return -1;
+}
+
+
+// Returns -1 if the row is falsified, 1 if it implies its last unassigned var
+// and 0 otherwise
+int uksat::XorMatrix::checkrow(std::size_t rowidx, std::vector<int>& implied) {
+    const uint64_t* row = getrow(rowidx);
+    uint64_t ones = 0;
+    int freecol = -1;
+
+    for (std::size_t word = 0; word < nwords; word++) {
+        uint64_t free = row[word] & ~assigned[word];
+        if (free) {
+            if (freecol >= 0 || (free & (free - 1))) return 0;
+            freecol = (word << 6) + lowestbit(free);
+        }
+        ones ^= row[word] & assigned[word] & values[word];
+    }
+
+    // The values of the row, its parity included, must add up to 0
+    int odd = parity(ones);
+    if (freecol < 0) return odd ? -1 : 0;
+
+    implied.push_back(odd ? colvars[freecol] : -colvars[freecol]);
+    return 1;
+}
+
+
+void uksat::XorMatrix::touch(std::size_t rowidx) {
+    if (!istouched[rowidx]) {
+        istouched[rowidx] = 1;
+        touched.push_back(rowidx);
+    }
+}